@@ -0,0 +1,481 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ *
+ * Times the search for the closest dictionary words to a set of misspelled
+ * words with each way of computing edit distances, with delete indexes of
+ * each distance, with a BK-tree, with a DAWG and with Levenshtein automata
+ * run over it, counting the distances (or for the DAWG, matrix rows, and
+ * for the automata, edges followed) each computes.
+ *
+ * usage: bench [dictionary [rounds]]
+ */
+
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+#include "deleteIndex.h"
+#include "bkTree.h"
+#include "dawg.h"
+#include "levenshteinAutomaton.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DICTIONARY "dictionary.txt"
+// number of times every query is scanned by each method
+#define BENCH_ROUNDS 3
+// number of closest words every scan finds
+#define BENCH_SUGGESTIONS 5
+
+/*
+ * dictionary words with their lengths worked out once
+ */
+struct WordList {
+	char ** words;
+	int * lengths;
+	int size;
+};
+
+/*
+ * smallest distances seen by a scan, sorted ascending
+ */
+struct TopDistances {
+	int distances[BENCH_SUGGESTIONS];
+};
+
+/*
+ * the smallest distances found by one walk of a deepening search, and the
+ * largest distance the walk reports
+ */
+struct Deepening {
+	struct TopDistances * top;
+	int cutoff;
+};
+
+/*
+ * scans the dictionary for the closest words to one query
+ * @param words
+ * @param query
+ * @param length number of characters in query
+ * @return sum of the BENCH_SUGGESTIONS smallest distances, compared
+ *         between methods
+ */
+typedef long (*ScanFunction)(const struct WordList * words,
+	const char * query, int length);
+
+struct Method {
+	const char * name;
+	ScanFunction scan;
+	// batch kernel the method needs, or -1
+	int kernel;
+	// distance of the delete index or automata the method uses, or 0
+	int distance;
+};
+
+static const char * queries[] = {
+	"teh", "speling", "recieve", "definately", "accomodate", "occurence",
+	"seperate", "wierd", "thier", "untill", "beleive", "independant",
+	"knowlege", "publically", "responsability", "xylophoen"
+};
+#define NUM_QUERIES ((int)(sizeof(queries) / sizeof(queries[0])))
+
+// scratch memory of the single benchmark thread
+static EditDistance engine;
+// the dictionary laid out for the batch kernels
+static EditDistanceBatch batch;
+// the dictionary's variants, built for one distance at a time
+static DeleteIndex deletes;
+// queries scanDeletes had to scan for, or scanAutomaton had to walk the
+// DAWG for, since the last method started
+static int fallbacks;
+// distance scanAutomaton builds its automata for
+static int automatonDistance;
+// the dictionary as a BK-tree, built when first needed
+static BkTree tree;
+// the dictionary as a word graph, built when first needed
+static Dawg dawg;
+// distances computed since the last method started, by the methods that
+// count them
+static long evaluations;
+
+/*
+ * fill the list with distances any word beats
+ * @param top
+ */
+static void topInit(struct TopDistances * top) {
+	for (int i = 0; i < BENCH_SUGGESTIONS; ++i) {
+		top->distances[i] = 255;
+	}
+}
+
+/*
+ * add the distance to the list if it is smaller than the last one
+ * @param top
+ * @param distance
+ */
+static void topOffer(struct TopDistances * top, int distance) {
+	int i = BENCH_SUGGESTIONS - 1;
+	if (distance >= top->distances[i]) {
+		return;
+	}
+	while (i > 0 && distance < top->distances[i - 1]) {
+		top->distances[i] = top->distances[i - 1];
+		--i;
+	}
+	top->distances[i] = distance;
+}
+
+/*
+ * @param top
+ * @return sum of the distances in the list
+ */
+static long topSum(const struct TopDistances * top) {
+	long sum = 0;
+	for (int i = 0; i < BENCH_SUGGESTIONS; ++i) {
+		sum += top->distances[i];
+	}
+	return sum;
+}
+
+/*
+ * baseline: levenshtein() on every word, allocating its rows each time
+ */
+static long scanLevenshtein(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	topInit(&top);
+	for (int i = 0; i < words->size; ++i) {
+		topOffer(&top, levenshtein(query, words->words[i]));
+	}
+	evaluations += words->size;
+	return topSum(&top);
+}
+
+/*
+ * editDistance() with reused scratch memory and precomputed lengths
+ */
+static long scanEditDistance(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	topInit(&top);
+	for (int i = 0; i < words->size; ++i) {
+		topOffer(&top, editDistance(&engine, query, length,
+			words->words[i], words->lengths[i]));
+	}
+	evaluations += words->size;
+	return topSum(&top);
+}
+
+/*
+ * editDistanceBounded() cut off just below the current last distance
+ */
+static long scanBounded(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	topInit(&top);
+	for (int i = 0; i < words->size; ++i) {
+		topOffer(&top, editDistanceBounded(&engine, query, length,
+			words->words[i], words->lengths[i],
+			top.distances[BENCH_SUGGESTIONS - 1] - 1));
+	}
+	evaluations += words->size;
+	return topSum(&top);
+}
+
+/*
+ * editDistancePattern() with the same cutoff, the query prepared once
+ */
+static long scanPattern(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	for (int i = 0; i < words->size; ++i) {
+		topOffer(&top, editDistancePattern(&engine, &pattern,
+			words->words[i], words->lengths[i],
+			top.distances[BENCH_SUGGESTIONS - 1] - 1));
+	}
+	evaluations += words->size;
+	return topSum(&top);
+}
+
+/*
+ * editDistanceBatchScan visitor that adds the distance to the
+ * struct TopDistances
+ * @return cutoff just below the last distance
+ */
+static int batchVisit(int index, int distance, void * context) {
+	struct TopDistances * top = context;
+	topOffer(top, distance);
+	return top->distances[BENCH_SUGGESTIONS - 1] - 1;
+}
+
+/*
+ * editDistanceBatchScan() with whichever kernel the batch is set to
+ */
+static long scanBatch(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	editDistanceBatchScan(&engine, &batch, &pattern,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, NULL, batchVisit, &top);
+	return topSum(&top);
+}
+
+/*
+ * editDistanceBatchScanNearest() with whichever kernel the batch is set to
+ */
+static long scanNearest(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	editDistanceBatchScanNearest(&engine, &batch, &pattern,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, NULL, batchVisit, &top);
+	return topSum(&top);
+}
+
+/*
+ * deleteIndexFind() with the same cutoff, falling back to scanBatch() when
+ * fewer words than wanted are within the index's distance
+ */
+static long scanDeletes(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	evaluations += deleteIndexFind(&deletes, &engine, &pattern,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, batchVisit, &top);
+	if (top.distances[BENCH_SUGGESTIONS - 1] > deletes.maxDistance) {
+		++fallbacks;
+		evaluations += words->size;
+		return scanBatch(words, query, length);
+	}
+	return topSum(&top);
+}
+
+/*
+ * bkTreeFind() with the same cutoff
+ */
+static long scanBkTree(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	evaluations += bkTreeFind(&tree, &engine, &pattern,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, batchVisit, &top);
+	return topSum(&top);
+}
+
+/*
+ * dawgFindNear() with the same cutoff
+ */
+static long scanDawg(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	EditDistancePattern pattern;
+	topInit(&top);
+	editDistancePatternInit(&pattern, query, length);
+	evaluations += dawgFindNear(&dawg, &pattern,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, batchVisit, &top);
+	return topSum(&top);
+}
+
+/*
+ * batchVisit() for a walk that reports no word past the deepening's cutoff
+ * @return cutoff just below the last distance, at most the deepening's
+ */
+static int deepeningVisit(int index, int distance, void * context) {
+	struct Deepening * deepening = context;
+	int cutoff = batchVisit(index, distance, deepening->top);
+	return cutoff < deepening->cutoff ? cutoff : deepening->cutoff;
+}
+
+/*
+ * levenshteinAutomatonFind() with the same cutoff over the DAWG; when
+ * fewer words than wanted are that close the DAWG is walked again with the
+ * cutoff one larger each time until enough are found, the way
+ * suggestionIndexFind() does
+ */
+static long scanAutomaton(const struct WordList * words,
+		const char * query, int length) {
+	struct TopDistances top;
+	LevenshteinAutomaton automaton;
+	topInit(&top);
+	levenshteinAutomatonInit(&automaton, query, length, automatonDistance);
+	evaluations += levenshteinAutomatonFind(&automaton, &dawg,
+		top.distances[BENCH_SUGGESTIONS - 1] - 1, batchVisit, &top);
+	levenshteinAutomatonCleanUp(&automaton);
+	if (top.distances[BENCH_SUGGESTIONS - 1] > automatonDistance) {
+		struct Deepening deepening;
+		EditDistancePattern pattern;
+		++fallbacks;
+		editDistancePatternInit(&pattern, query, length);
+		deepening.top = &top;
+		deepening.cutoff = automatonDistance;
+		while (top.distances[BENCH_SUGGESTIONS - 1] > deepening.cutoff) {
+			++deepening.cutoff;
+			topInit(&top);
+			evaluations += dawgFindNear(&dawg, &pattern, deepening.cutoff,
+				deepeningVisit, &deepening);
+		}
+	}
+	return topSum(&top);
+}
+
+static const struct Method methods[] = {
+	{ "levenshtein", scanLevenshtein, -1, 0 },
+	{ "editDistance", scanEditDistance, -1, 0 },
+	{ "bounded", scanBounded, -1, 0 },
+	{ "bit-parallel", scanPattern, -1, 0 },
+	{ "batch-scalar", scanBatch, EDIT_BATCH_SCALAR, 0 },
+	{ "batch-sse2", scanBatch, EDIT_BATCH_SSE2, 0 },
+	{ "batch-avx2", scanBatch, EDIT_BATCH_AVX2, 0 },
+	{ "nearest-scalar", scanNearest, EDIT_BATCH_SCALAR, 0 },
+	{ "nearest-avx2", scanNearest, EDIT_BATCH_AVX2, 0 },
+	{ "deletes-1", scanDeletes, -1, 1 },
+	{ "deletes-2", scanDeletes, -1, 2 },
+	{ "deletes-3", scanDeletes, -1, 3 },
+	{ "bk-tree", scanBkTree, -1, 0 },
+	{ "dawg", scanDawg, -1, 0 },
+	{ "automaton-1", scanAutomaton, -1, 1 },
+	{ "automaton-2", scanAutomaton, -1, 2 }
+};
+#define NUM_METHODS ((int)(sizeof(methods) / sizeof(methods[0])))
+
+/*
+ * read every whitespace separated word of the file
+ * @param file
+ * @param words filled with the allocated words
+ */
+static void readWords(FILE * file, struct WordList * words) {
+	char buffer[256];
+	int capacity = 1024;
+
+	words->size = 0;
+	words->words = malloc(sizeof(char *) * capacity);
+	words->lengths = malloc(sizeof(int) * capacity);
+	assert(words->words && words->lengths);
+	while (fscanf(file, "%255s", buffer) == 1) {
+		if (words->size == capacity) {
+			capacity *= 2;
+			words->words = realloc(words->words, sizeof(char *) * capacity);
+			words->lengths = realloc(words->lengths, sizeof(int) * capacity);
+			assert(words->words && words->lengths);
+		}
+		words->lengths[words->size] = strlen(buffer);
+		words->words[words->size] = malloc(words->lengths[words->size] + 1);
+		assert(words->words[words->size]);
+		strcpy(words->words[words->size], buffer);
+		++(words->size);
+	}
+}
+
+int main(int argc, const char ** argv) {
+	const char * path = argc > 1 ? argv[1] : BENCH_DICTIONARY;
+	int rounds = argc > 2 ? atoi(argv[2]) : BENCH_ROUNDS;
+	struct WordList words;
+	FILE * file = fopen(path, "r");
+
+	if (!file || rounds < 1) {
+		fprintf(stderr, "usage: bench [dictionary [rounds]]\n");
+		return 1;
+	}
+	readWords(file, &words);
+	fclose(file);
+	editDistanceInit(&engine);
+	editDistanceBatchInit(&batch, (const char **)words.words, words.lengths,
+		words.size);
+
+	printf("%d words, %d queries, %d rounds\n", words.size, NUM_QUERIES,
+		rounds);
+	printf("%-16s %12s %12s %12s\n", "method", "ms/scan", "checksum",
+		"evals/scan");
+	for (int m = 0; m < NUM_METHODS; ++m) {
+		long checksum = 0;
+		if (methods[m].kernel >= 0
+				&& !editDistanceBatchUseKernel(&batch, methods[m].kernel)) {
+			printf("%-16s %12s\n", methods[m].name, "unsupported");
+			continue;
+		}
+		if (methods[m].scan == scanDeletes) {
+			clock_t build = clock();
+			if (deletes.variants) {
+				deleteIndexCleanUp(&deletes);
+			}
+			deleteIndexInit(&deletes, (const char **)words.words,
+				words.lengths, words.size, methods[m].distance);
+			printf("%-16s built in %.0f ms: %d variants, %d postings\n",
+				methods[m].name,
+				1000.0 * (clock() - build) / CLOCKS_PER_SEC,
+				hashMapSize(deletes.variants), deletes.numPostings);
+		}
+		if (methods[m].scan == scanBkTree && !tree.nodes) {
+			clock_t build = clock();
+			bkTreeInit(&tree, &engine, (const char **)words.words,
+				words.lengths, words.size);
+			printf("%-16s built in %.0f ms\n", methods[m].name,
+				1000.0 * (clock() - build) / CLOCKS_PER_SEC);
+		}
+		if ((methods[m].scan == scanDawg || methods[m].scan == scanAutomaton)
+				&& !dawg.nodes) {
+			clock_t build = clock();
+			dawgInit(&dawg, (const char **)words.words, words.lengths,
+				words.size);
+			printf("%-16s built in %.0f ms: %d nodes, %d edges, %zu KB\n",
+				methods[m].name, 1000.0 * (clock() - build) / CLOCKS_PER_SEC,
+				dawg.numNodes, dawg.numEdges, dawgBytes(&dawg) / 1024);
+		}
+		automatonDistance = methods[m].distance;
+		fallbacks = 0;
+		evaluations = 0;
+		clock_t start = clock();
+		for (int r = 0; r < rounds; ++r) {
+			for (int q = 0; q < NUM_QUERIES; ++q) {
+				checksum += methods[m].scan(&words, queries[q],
+					strlen(queries[q]));
+			}
+		}
+		double ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+		if (evaluations > 0) {
+			printf("%-16s %12.3f %12ld %12ld\n", methods[m].name,
+				ms / (rounds * NUM_QUERIES), checksum / rounds,
+				evaluations / (rounds * NUM_QUERIES));
+		}
+		else {
+			printf("%-16s %12.3f %12ld %12s\n", methods[m].name,
+				ms / (rounds * NUM_QUERIES), checksum / rounds, "-");
+		}
+		if (methods[m].distance > 0) {
+			printf("%-16s %d of %d queries fell back to the %s\n", "",
+				fallbacks / rounds, NUM_QUERIES,
+				methods[m].scan == scanDeletes ? "scan" : "dawg");
+		}
+	}
+
+	editDistanceCleanUp(&engine);
+	editDistanceBatchCleanUp(&batch);
+	if (deletes.variants) {
+		deleteIndexCleanUp(&deletes);
+	}
+	if (tree.nodes) {
+		bkTreeCleanUp(&tree);
+	}
+	if (dawg.nodes) {
+		dawgCleanUp(&dawg);
+	}
+	for (int i = 0; i < words.size; ++i) {
+		free(words.words[i]);
+	}
+	free(words.words);
+	free(words.lengths);
+	return 0;
+}
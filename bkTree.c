@@ -0,0 +1,240 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "bkTree.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct BkVisit BkVisit;
+
+/*
+ * A node bkTreeFind still has to look at, with the distance between the
+ * query and the node's parent so it can be skipped if the cutoff has
+ * dropped since it was found.
+ */
+struct BkVisit
+{
+    int node;
+    int parentDistance;
+};
+
+/**
+ * Computes the exact edit distance between the pattern and a word, which
+ * the tree needs even when it is over any cutoff.
+ * @param engine
+ * @param pattern
+ * @param word
+ * @param length Number of characters in word.
+ * @return The distance.
+ */
+static int bkTreeDistance(EditDistance* engine,
+                          const EditDistancePattern* pattern,
+                          const char* word, int length)
+{
+    // no distance is over the longer length
+    return editDistancePattern(engine, pattern, word, length,
+                               pattern->length + length);
+}
+
+/**
+ * Builds the tree, inserting the words in order: each one walks down from
+ * the root along the child whose edge is its distance to the node, and
+ * becomes a new child where there is none. The linked tree this makes is
+ * then laid out breadth first in one array. The words are not copied and
+ * must outlive the tree.
+ * @param tree
+ * @param engine Scratch memory for the distances.
+ * @param words
+ * @param lengths Number of characters in each word.
+ * @param size Number of words.
+ */
+void bkTreeInit(BkTree* tree, EditDistance* engine, const char** words,
+                const int* lengths, int size)
+{
+    assert(tree);
+    assert(engine);
+    assert(size >= 0);
+
+    tree->words = words;
+    tree->lengths = lengths;
+    tree->size = size;
+    tree->nodes = malloc(sizeof(BkNode) * (size + 1));
+    assert(tree->nodes);
+    if (size == 0)
+    {
+        return;
+    }
+
+    // linked tree, indexed by word
+    int* firstChild = malloc(sizeof(int) * size);
+    int* nextSibling = malloc(sizeof(int) * size);
+    int* edges = malloc(sizeof(int) * size);
+    assert(firstChild && nextSibling && edges);
+    memset(firstChild, -1, sizeof(int) * size);
+    EditDistancePattern pattern;
+    for (int word = 1; word < size; word++)
+    {
+        editDistancePatternInit(&pattern, words[word], lengths[word]);
+        int node = 0;
+        while (1)
+        {
+            int distance = bkTreeDistance(engine, &pattern, words[node],
+                                          lengths[node]);
+            int child = firstChild[node];
+            while (child >= 0 && edges[child] != distance)
+            {
+                child = nextSibling[child];
+            }
+            if (child < 0)
+            {
+                edges[word] = distance;
+                nextSibling[word] = firstChild[node];
+                firstChild[node] = word;
+                break;
+            }
+            node = child;
+        }
+    }
+
+    // breadth first, so each node's children are appended together
+    tree->nodes[0].word = 0;
+    tree->nodes[0].edge = 0;
+    int numNodes = 1;
+    for (int n = 0; n < numNodes; n++)
+    {
+        BkNode* node = &tree->nodes[n];
+        node->firstChild = numNodes;
+        node->numChildren = 0;
+        for (int child = firstChild[node->word]; child >= 0;
+             child = nextSibling[child])
+        {
+            // insertion sort by edge
+            int i = numNodes + node->numChildren++;
+            while (i > node->firstChild && tree->nodes[i - 1].edge
+                                           > edges[child])
+            {
+                tree->nodes[i] = tree->nodes[i - 1];
+                i--;
+            }
+            tree->nodes[i].word = child;
+            tree->nodes[i].edge = edges[child];
+        }
+        numNodes += node->numChildren;
+    }
+    assert(numNodes == size);
+
+    free(firstChild);
+    free(nextSibling);
+    free(edges);
+}
+
+/**
+ * Frees the tree. The words themselves are not touched.
+ * @param tree
+ */
+void bkTreeCleanUp(BkTree* tree)
+{
+    assert(tree);
+    free(tree->nodes);
+    tree->nodes = NULL;
+    tree->size = 0;
+}
+
+/**
+ * Reports every word within the cutoff of the pattern to the visitor,
+ * like editDistanceBatchScan but in tree order. The visitor returns the
+ * cutoff for the rest of the search; a fixed one finds all words within
+ * it, and one that drops as closer words turn up finds the nearest. The
+ * children closest to the query's distance from their parent are looked
+ * at first, as the nearest words are most likely under them. The tree is
+ * only read, so threads with their own engines can share it.
+ * @param tree
+ * @param engine Scratch memory used by the calling thread.
+ * @param pattern The query.
+ * @param cutoff Largest distance to report.
+ * @param visitor
+ * @param context Passed through to the visitor.
+ * @return Number of distances computed.
+ */
+int bkTreeFind(const BkTree* tree, EditDistance* engine,
+               const EditDistancePattern* pattern, int cutoff,
+               EditBatchVisitor visitor, void* context)
+{
+    assert(tree);
+    assert(pattern);
+    assert(visitor);
+
+    if (tree->size == 0 || cutoff < 0)
+    {
+        return 0;
+    }
+
+    int capacity = 256;
+    int count = 0;
+    int evaluations = 0;
+    BkVisit* stack = malloc(sizeof(BkVisit) * capacity);
+    assert(stack);
+    stack[count].node = 0;
+    stack[count].parentDistance = 0;
+    count++;
+    while (count > 0 && cutoff >= 0)
+    {
+        BkVisit visit = stack[--count];
+        const BkNode* node = &tree->nodes[visit.node];
+        if (abs(node->edge - visit.parentDistance) > cutoff)
+        {
+            continue;
+        }
+
+        int distance = bkTreeDistance(engine, pattern,
+                                      tree->words[node->word],
+                                      tree->lengths[node->word]);
+        evaluations++;
+        if (distance <= cutoff)
+        {
+            cutoff = visitor(node->word, distance, context);
+        }
+
+        // children with an edge in range, the closest to distance last
+        int low = node->firstChild;
+        int high = node->firstChild + node->numChildren - 1;
+        while (low <= high && tree->nodes[low].edge < distance - cutoff)
+        {
+            low++;
+        }
+        while (low <= high && tree->nodes[high].edge > distance + cutoff)
+        {
+            high--;
+        }
+        if (count + high - low + 1 > capacity)
+        {
+            while (count + high - low + 1 > capacity)
+            {
+                capacity *= 2;
+            }
+            stack = realloc(stack, sizeof(BkVisit) * capacity);
+            assert(stack);
+        }
+        while (low <= high)
+        {
+            int child;
+            if (distance - tree->nodes[low].edge
+                > tree->nodes[high].edge - distance)
+            {
+                child = low++;
+            }
+            else
+            {
+                child = high--;
+            }
+            stack[count].node = child;
+            stack[count].parentDistance = distance;
+            count++;
+        }
+    }
+    free(stack);
+    return evaluations;
+}
@@ -0,0 +1,54 @@
+#ifndef BK_TREE_H
+#define BK_TREE_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+
+typedef struct BkTree BkTree;
+typedef struct BkNode BkNode;
+
+/*
+ * One word of a BkTree.
+ */
+struct BkNode
+{
+    // Index of the word in the list the tree was built from.
+    int word;
+    // Distance between this word and its parent's.
+    int edge;
+    // Position of the first child in the tree's nodes; the others follow.
+    int firstChild;
+    int numChildren;
+};
+
+/*
+ * A Burkhard-Keller tree of a word list: every word below a node's child
+ * is the child's edge away from the node's word. By the triangle
+ * inequality, a word within the cutoff of a query that is d away from a
+ * node can only be under a child whose edge is within the cutoff of d, so
+ * the other children are never looked at.
+ */
+struct BkTree
+{
+    // Words the tree was built from, not copied.
+    const char** words;
+    const int* lengths;
+    int size;
+    // One node per word in breadth-first order, the root first. The
+    // children of a node are next to each other, sorted by edge.
+    BkNode* nodes;
+};
+
+void bkTreeInit(BkTree* tree, EditDistance* engine, const char** words,
+                const int* lengths, int size);
+void bkTreeCleanUp(BkTree* tree);
+int bkTreeFind(const BkTree* tree, EditDistance* engine,
+               const EditDistancePattern* pattern, int cutoff,
+               EditBatchVisitor visitor, void* context);
+
+#endif
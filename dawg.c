@@ -0,0 +1,382 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "dawg.h"
+#include "hashMap.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Longest node signature: the final flag, then a label, an id and a comma
+// per edge, and the terminating null.
+#define DAWG_SIGNATURE_SIZE (2 + 256 * 13)
+
+typedef struct DawgWord DawgWord;
+typedef struct DawgSearch DawgSearch;
+
+/*
+ * A word and its index in the list, sorted by dawgInit.
+ */
+struct DawgWord
+{
+    const char* word;
+    int index;
+};
+
+/*
+ * State of dawgFindNear while it walks the graph.
+ */
+struct DawgSearch
+{
+    const Dawg* dawg;
+    const char* query;
+    int length;
+    // One row of the edit distance matrix per depth of the walk, each
+    // length + 1 cells.
+    int* rows;
+    int cutoff;
+    EditBatchVisitor visitor;
+    void* context;
+    int rowsComputed;
+};
+
+/**
+ * qsort comparison of two DawgWords by their words, which orders them the
+ * same way as the labels of a node's edges.
+ * @param a
+ * @param b
+ * @return Negative, 0 or positive as a is below, equal to or above b.
+ */
+static int dawgCompareWords(const void* a, const void* b)
+{
+    return strcmp(((const DawgWord*)a)->word, ((const DawgWord*)b)->word);
+}
+
+/**
+ * Builds the graph of the words. They are sorted and laid out as a trie,
+ * each word appending nodes only past the prefix it shares with the one
+ * before it. The trie is then minimized from the leaves up: a node is
+ * identified by whether it is final and by the labels and merged targets
+ * of its edges, and every node with the same signature as one already
+ * kept is replaced by it. Repeated words are kept once. The words are not
+ * referenced after this returns.
+ * @param dawg
+ * @param words
+ * @param lengths Number of characters in each word.
+ * @param size Number of words.
+ */
+void dawgInit(Dawg* dawg, const char** words, const int* lengths, int size)
+{
+    assert(dawg);
+    assert(size >= 0);
+
+    DawgWord* sorted = malloc(sizeof(DawgWord) * (size + 1));
+    int numCharacters = 0;
+    assert(sorted);
+    dawg->maxLength = 0;
+    for (int i = 0; i < size; i++)
+    {
+        sorted[i].word = words[i];
+        sorted[i].index = i;
+        numCharacters += lengths[i];
+        if (lengths[i] > dawg->maxLength)
+        {
+            dawg->maxLength = lengths[i];
+        }
+    }
+    qsort(sorted, size, sizeof(DawgWord), dawgCompareWords);
+
+    // the trie, one node per character at most, children in label order
+    int capacity = numCharacters + 1;
+    uint8_t* labels = malloc(capacity);
+    char* finals = calloc(capacity, 1);
+    int* firstChild = malloc(sizeof(int) * capacity);
+    int* lastChild = malloc(sizeof(int) * capacity);
+    int* nextSibling = malloc(sizeof(int) * capacity);
+    int* path = malloc(sizeof(int) * (dawg->maxLength + 1));
+    assert(labels && finals && firstChild && lastChild && nextSibling && path);
+    int numTrie = 1;
+    firstChild[0] = -1;
+    path[0] = 0;
+    const char* previous = "";
+    dawg->order = malloc(sizeof(int) * (size + 1));
+    assert(dawg->order);
+    dawg->size = 0;
+    for (int i = 0; i < size; i++)
+    {
+        const char* word = sorted[i].word;
+        int length = lengths[sorted[i].index];
+        int shared = 0;
+        while (shared < length && word[shared] == previous[shared])
+        {
+            shared++;
+        }
+        if (shared == length && previous[shared] == '\0' && i > 0)
+        {
+            continue;
+        }
+        for (int depth = shared; depth < length; depth++)
+        {
+            int parent = path[depth];
+            int node = numTrie++;
+            labels[node] = word[depth];
+            firstChild[node] = -1;
+            nextSibling[node] = -1;
+            if (firstChild[parent] < 0)
+            {
+                firstChild[parent] = node;
+            }
+            else
+            {
+                nextSibling[lastChild[parent]] = node;
+            }
+            lastChild[parent] = node;
+            path[depth + 1] = node;
+        }
+        finals[path[length]] = 1;
+        dawg->order[dawg->size++] = sorted[i].index;
+        previous = word;
+    }
+    free(sorted);
+    free(lastChild);
+    free(path);
+
+    // children come after their parents, so walking back merges leaves up
+    HashMap* registry = hashMapNewBackend(numTrie / 4 + 1,
+                                          HASH_MAP_OPEN_ADDRESSING);
+    int* merged = malloc(sizeof(int) * numTrie);
+    char* signature = malloc(DAWG_SIGNATURE_SIZE);
+    dawg->nodes = malloc(sizeof(DawgNode) * numTrie);
+    dawg->edges = malloc(sizeof(DawgEdge) * numTrie);
+    assert(merged && signature && dawg->nodes && dawg->edges);
+    dawg->numNodes = 0;
+    dawg->numEdges = 0;
+    for (int node = numTrie - 1; node >= 0; node--)
+    {
+        int position = 0;
+        signature[position++] = finals[node] ? '1' : '0';
+        for (int child = firstChild[node]; child >= 0;
+             child = nextSibling[child])
+        {
+            signature[position++] = labels[child];
+            position += sprintf(signature + position, "%d,", merged[child]);
+        }
+        signature[position] = '\0';
+
+        int id = *hashMapFindOrInsert(registry, signature, dawg->numNodes);
+        if (id == dawg->numNodes)
+        {
+            DawgNode* kept = &dawg->nodes[dawg->numNodes++];
+            kept->firstEdge = dawg->numEdges;
+            kept->numEdges = 0;
+            kept->numWords = finals[node];
+            kept->final = finals[node];
+            for (int child = firstChild[node]; child >= 0;
+                 child = nextSibling[child])
+            {
+                DawgEdge* edge = &dawg->edges[dawg->numEdges++];
+                edge->target = merged[child];
+                edge->label = labels[child];
+                kept->numEdges++;
+                kept->numWords += dawg->nodes[edge->target].numWords;
+            }
+        }
+        merged[node] = id;
+    }
+    dawg->root = merged[0];
+    hashMapDelete(registry);
+    free(merged);
+    free(signature);
+    free(labels);
+    free(finals);
+    free(firstChild);
+    free(nextSibling);
+
+    dawg->nodes = realloc(dawg->nodes, sizeof(DawgNode) * dawg->numNodes);
+    dawg->edges = realloc(dawg->edges,
+                          sizeof(DawgEdge) * (dawg->numEdges + 1));
+    assert(dawg->nodes && dawg->edges);
+}
+
+/**
+ * Frees the graph.
+ * @param dawg
+ */
+void dawgCleanUp(Dawg* dawg)
+{
+    assert(dawg);
+    free(dawg->order);
+    free(dawg->nodes);
+    free(dawg->edges);
+    dawg->order = NULL;
+    dawg->nodes = NULL;
+    dawg->edges = NULL;
+    dawg->size = 0;
+    dawg->numNodes = 0;
+    dawg->numEdges = 0;
+}
+
+/**
+ * @param dawg
+ * @return Number of bytes the graph takes up.
+ */
+size_t dawgBytes(const Dawg* dawg)
+{
+    assert(dawg);
+    return sizeof(Dawg) + sizeof(int) * dawg->size
+           + sizeof(DawgNode) * dawg->numNodes
+           + sizeof(DawgEdge) * dawg->numEdges;
+}
+
+/**
+ * Looks a word up by walking its path from the root, counting the words
+ * passed on the way to number it.
+ * @param dawg
+ * @param word
+ * @param length Number of characters in word.
+ * @return Index of the word in the list the graph was built from, or -1
+ *         if it is not in the graph.
+ */
+int dawgFind(const Dawg* dawg, const char* word, int length)
+{
+    assert(dawg);
+    assert(word);
+
+    if (dawg->size == 0)
+    {
+        return -1;
+    }
+    int node = dawg->root;
+    int rank = 0;
+    for (int i = 0; i < length; i++)
+    {
+        const DawgNode* current = &dawg->nodes[node];
+        uint8_t label = word[i];
+        int next = -1;
+        rank += current->final;
+        for (int e = current->firstEdge;
+             e < current->firstEdge + current->numEdges; e++)
+        {
+            const DawgEdge* edge = &dawg->edges[e];
+            if (edge->label >= label)
+            {
+                next = edge->label == label ? edge->target : -1;
+                break;
+            }
+            rank += dawg->nodes[edge->target].numWords;
+        }
+        if (next < 0)
+        {
+            return -1;
+        }
+        node = next;
+    }
+    return dawg->nodes[node].final ? dawg->order[rank] : -1;
+}
+
+/**
+ * Visits the words below a node, depth first in label order. The search's
+ * row for the node's depth holds the distances between the path to the
+ * node and each prefix of the query; the row of each child is worked out
+ * from it, and a child is skipped once every cell of its row is over the
+ * cutoff, as longer paths can only be further away.
+ * @param search
+ * @param node
+ * @param depth Length of the path to the node.
+ * @param rank Number of words before the node's in sorted order.
+ */
+static void dawgWalk(DawgSearch* search, int node, int depth, int rank)
+{
+    const Dawg* dawg = search->dawg;
+    const DawgNode* current = &dawg->nodes[node];
+    int length = search->length;
+    const int* row = search->rows + (size_t)depth * (length + 1);
+    int* next = search->rows + (size_t)(depth + 1) * (length + 1);
+
+    if (current->final && row[length] <= search->cutoff)
+    {
+        search->cutoff = search->visitor(dawg->order[rank], row[length],
+                                         search->context);
+    }
+    rank += current->final;
+    for (int e = current->firstEdge;
+         e < current->firstEdge + current->numEdges && search->cutoff >= 0;
+         e++)
+    {
+        const DawgEdge* edge = &dawg->edges[e];
+        int smallest = next[0] = depth + 1;
+        for (int j = 1; j <= length; j++)
+        {
+            int cell = row[j - 1]
+                       + ((uint8_t)search->query[j - 1] != edge->label);
+            if (row[j] + 1 < cell)
+            {
+                cell = row[j] + 1;
+            }
+            if (next[j - 1] + 1 < cell)
+            {
+                cell = next[j - 1] + 1;
+            }
+            next[j] = cell;
+            if (cell < smallest)
+            {
+                smallest = cell;
+            }
+        }
+        search->rowsComputed++;
+        if (smallest <= search->cutoff)
+        {
+            dawgWalk(search, edge->target, depth + 1, rank);
+        }
+        rank += dawg->nodes[edge->target].numWords;
+    }
+}
+
+/**
+ * Reports every word within the cutoff of the pattern to the visitor, in
+ * sorted order, like editDistanceBatchScan. The graph is walked depth
+ * first carrying one row of the edit distance matrix per node, so words
+ * that share a prefix share the work of measuring it, and whole subtrees
+ * are skipped once their prefix is too far from the query. The graph is
+ * only read, so threads can share it.
+ * @param dawg
+ * @param pattern The query.
+ * @param cutoff Largest distance to report.
+ * @param visitor Returns the cutoff for the rest of the walk.
+ * @param context Passed through to the visitor.
+ * @return Number of matrix rows computed, one per edge followed.
+ */
+int dawgFindNear(const Dawg* dawg, const EditDistancePattern* pattern,
+                 int cutoff, EditBatchVisitor visitor, void* context)
+{
+    assert(dawg);
+    assert(pattern);
+    assert(visitor);
+
+    if (dawg->size == 0 || cutoff < 0)
+    {
+        return 0;
+    }
+
+    DawgSearch search;
+    search.dawg = dawg;
+    search.query = pattern->string;
+    search.length = pattern->length;
+    search.cutoff = cutoff;
+    search.visitor = visitor;
+    search.context = context;
+    search.rowsComputed = 0;
+    search.rows = malloc(sizeof(int) * (dawg->maxLength + 2)
+                         * (pattern->length + 1));
+    assert(search.rows);
+    for (int j = 0; j <= pattern->length; j++)
+    {
+        search.rows[j] = j;
+    }
+    dawgWalk(&search, dawg->root, 0, 0);
+    free(search.rows);
+    return search.rowsComputed;
+}
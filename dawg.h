@@ -0,0 +1,67 @@
+#ifndef DAWG_H
+#define DAWG_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+#include <stdint.h>
+
+typedef struct Dawg Dawg;
+typedef struct DawgNode DawgNode;
+typedef struct DawgEdge DawgEdge;
+
+/*
+ * A state of a Dawg.
+ */
+struct DawgNode
+{
+    // Position of the first outgoing edge in the graph's edges; the others
+    // follow, sorted by label.
+    int firstEdge;
+    int numEdges;
+    // Number of words spelled by the paths from here to a final node,
+    // counting this one.
+    int numWords;
+    // 1 if the path to this node spells a word.
+    int final;
+};
+
+struct DawgEdge
+{
+    int target;
+    uint8_t label;
+};
+
+/*
+ * A minimal directed acyclic word graph of a word list: the trie of the
+ * words with every set of identical subtrees merged into one, so shared
+ * suffixes are stored once as well as shared prefixes. Each node counts
+ * the words below it, which numbers the words in sorted order as a path
+ * is followed; order maps those numbers back to the list.
+ */
+struct Dawg
+{
+    // Index in the original list of each word, in sorted order.
+    int* order;
+    // Number of different words.
+    int size;
+    int maxLength;
+    DawgNode* nodes;
+    int numNodes;
+    DawgEdge* edges;
+    int numEdges;
+    int root;
+};
+
+void dawgInit(Dawg* dawg, const char** words, const int* lengths, int size);
+void dawgCleanUp(Dawg* dawg);
+size_t dawgBytes(const Dawg* dawg);
+int dawgFind(const Dawg* dawg, const char* word, int length);
+int dawgFindNear(const Dawg* dawg, const EditDistancePattern* pattern,
+                 int cutoff, EditBatchVisitor visitor, void* context);
+
+#endif
@@ -0,0 +1,339 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "deleteIndex.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct DeleteBuild DeleteBuild;
+typedef struct DeleteQuery DeleteQuery;
+
+// Called by deleteIndexVariants with each variant of a string.
+typedef void (*DeleteVariantVisitor)(const char* variant, void* context);
+
+/*
+ * State of deleteIndexInit while it collects the lists.
+ */
+struct DeleteBuild
+{
+    DeleteIndex* index;
+    // Word whose variants are being added.
+    int word;
+    // Last word added to each list, so a word that gives the same variant
+    // twice is only listed once.
+    int* lastWord;
+    int lastCapacity;
+    // (list, word) pairs in the order they were found.
+    int* pairs;
+    int numPairs;
+    int pairCapacity;
+};
+
+/*
+ * Words found so far by deleteIndexFind, before duplicates are removed.
+ */
+struct DeleteQuery
+{
+    const DeleteIndex* index;
+    int* candidates;
+    int count;
+    int capacity;
+};
+
+/**
+ * Passes the string and every string made by deleting up to the given
+ * number of its characters to the visitor. Deletions are made left to
+ * right and only the first of a run of equal characters is deleted, which
+ * keeps most variants from being visited more than once; the rest of the
+ * repeats are up to the visitor.
+ * @param buffers The string, followed by room for one variant per deletion
+ *        still to make, stride bytes apart.
+ * @param stride
+ * @param length Number of characters in the string.
+ * @param start First character that may be deleted.
+ * @param deletes Number of characters that may still be deleted.
+ * @param visitor
+ * @param context Passed through to the visitor.
+ */
+static void deleteIndexVariants(char* buffers, int stride, int length,
+                                int start, int deletes,
+                                DeleteVariantVisitor visitor, void* context)
+{
+    const char* string = buffers;
+    char* next = buffers + stride;
+
+    visitor(string, context);
+    if (deletes == 0)
+    {
+        return;
+    }
+    for (int i = start; i < length; i++)
+    {
+        if (i > start && string[i] == string[i - 1])
+        {
+            continue;
+        }
+        memcpy(next, string, i);
+        memcpy(next + i, string + i + 1, length - i);
+        deleteIndexVariants(next, stride, length - 1, i, deletes - 1,
+                            visitor, context);
+    }
+}
+
+/**
+ * deleteIndexVariants visitor that adds the build's current word to the
+ * variant's list, starting a new list for a variant not seen before.
+ * @param variant
+ * @param context Pointer to the DeleteBuild.
+ */
+static void deleteBuildVisit(const char* variant, void* context)
+{
+    DeleteBuild* build = context;
+    DeleteIndex* index = build->index;
+    int list = *hashMapFindOrInsert(index->variants, variant,
+                                    index->numLists);
+
+    if (list == index->numLists)
+    {
+        if (index->numLists == build->lastCapacity)
+        {
+            build->lastCapacity *= 2;
+            build->lastWord = realloc(build->lastWord,
+                                      sizeof(int) * build->lastCapacity);
+            assert(build->lastWord);
+        }
+        build->lastWord[index->numLists++] = -1;
+    }
+    if (build->lastWord[list] == build->word)
+    {
+        return;
+    }
+    build->lastWord[list] = build->word;
+    if (build->numPairs == build->pairCapacity)
+    {
+        build->pairCapacity *= 2;
+        build->pairs = realloc(build->pairs,
+                               sizeof(int) * 2 * build->pairCapacity);
+        assert(build->pairs);
+    }
+    build->pairs[2 * build->numPairs] = list;
+    build->pairs[2 * build->numPairs + 1] = build->word;
+    build->numPairs++;
+}
+
+/**
+ * deleteIndexVariants visitor that adds the words listed under the
+ * variant, if any, to the query's candidates.
+ * @param variant
+ * @param context Pointer to the DeleteQuery.
+ */
+static void deleteQueryVisit(const char* variant, void* context)
+{
+    DeleteQuery* query = context;
+    const DeleteIndex* index = query->index;
+    int* list = hashMapGet(index->variants, variant);
+
+    if (!list)
+    {
+        return;
+    }
+    int first = index->starts[*list];
+    int count = index->starts[*list + 1] - first;
+    if (query->count + count > query->capacity)
+    {
+        while (query->count + count > query->capacity)
+        {
+            query->capacity *= 2;
+        }
+        query->candidates = realloc(query->candidates,
+                                    sizeof(int) * query->capacity);
+        assert(query->candidates);
+    }
+    memcpy(query->candidates + query->count, index->lists + first,
+           sizeof(int) * count);
+    query->count += count;
+}
+
+/**
+ * qsort comparison of two word indices.
+ * @param a
+ * @param b
+ * @return Negative, 0 or positive as a is below, equal to or above b.
+ */
+static int deleteIndexCompare(const void* a, const void* b)
+{
+    int left = *(const int*)a;
+    int right = *(const int*)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * Builds the index of every variant of the words with up to maxDistance
+ * characters deleted. The words are not copied and must outlive the
+ * index. Each extra character of distance costs several times the memory
+ * and build time of the one before.
+ * @param index
+ * @param words
+ * @param lengths Number of characters in each word.
+ * @param size Number of words.
+ * @param maxDistance Between 1 and DELETE_INDEX_MAX_DISTANCE.
+ */
+void deleteIndexInit(DeleteIndex* index, const char** words,
+                     const int* lengths, int size, int maxDistance)
+{
+    assert(index);
+    assert(size >= 0);
+    assert(maxDistance >= 1 && maxDistance <= DELETE_INDEX_MAX_DISTANCE);
+
+    index->words = words;
+    index->lengths = lengths;
+    index->size = size;
+    index->maxDistance = maxDistance;
+    index->variants = hashMapNewBackend(size + 1, HASH_MAP_OPEN_ADDRESSING);
+    index->numLists = 0;
+
+    int maxLength = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (lengths[i] > maxLength)
+        {
+            maxLength = lengths[i];
+        }
+    }
+    int stride = maxLength + 1;
+    char* buffers = malloc(stride * (maxDistance + 1));
+    DeleteBuild build;
+    build.index = index;
+    build.lastCapacity = 1024;
+    build.lastWord = malloc(sizeof(int) * build.lastCapacity);
+    build.pairCapacity = 1024;
+    build.pairs = malloc(sizeof(int) * 2 * build.pairCapacity);
+    build.numPairs = 0;
+    assert(buffers && build.lastWord && build.pairs);
+    for (build.word = 0; build.word < size; build.word++)
+    {
+        memcpy(buffers, words[build.word], lengths[build.word] + 1);
+        deleteIndexVariants(buffers, stride, lengths[build.word], 0,
+                            maxDistance, deleteBuildVisit, &build);
+    }
+
+    // counting sort of the pairs by list, keeping each list in word order
+    index->numPostings = build.numPairs;
+    index->starts = calloc(index->numLists + 1, sizeof(int));
+    index->lists = malloc(sizeof(int) * (build.numPairs + 1));
+    assert(index->starts && index->lists);
+    for (int i = 0; i < build.numPairs; i++)
+    {
+        index->starts[build.pairs[2 * i] + 1]++;
+    }
+    for (int list = 0; list < index->numLists; list++)
+    {
+        index->starts[list + 1] += index->starts[list];
+    }
+    for (int i = 0; i < build.numPairs; i++)
+    {
+        int list = build.pairs[2 * i];
+        index->lists[index->starts[list]++] = build.pairs[2 * i + 1];
+    }
+    // each start has moved up to the next list's start
+    memmove(index->starts + 1, index->starts, sizeof(int) * index->numLists);
+    index->starts[0] = 0;
+
+    free(buffers);
+    free(build.lastWord);
+    free(build.pairs);
+}
+
+/**
+ * Frees the index. The words themselves are not touched.
+ * @param index
+ */
+void deleteIndexCleanUp(DeleteIndex* index)
+{
+    assert(index);
+    hashMapDelete(index->variants);
+    free(index->starts);
+    free(index->lists);
+    index->variants = NULL;
+    index->starts = NULL;
+    index->lists = NULL;
+    index->size = 0;
+    index->numLists = 0;
+    index->numPostings = 0;
+}
+
+/**
+ * Reports every word within the cutoff of the pattern to the visitor, in
+ * the order the words were given to deleteIndexInit, like
+ * editDistanceBatchScan. The cutoff is capped at the index's maxDistance.
+ * Candidates are the words listed under any variant of the pattern with
+ * up to cutoff characters deleted; only they are measured. The index is
+ * only read, so threads with their own engines can share it.
+ * @param index
+ * @param engine Scratch memory used by the calling thread.
+ * @param pattern The query.
+ * @param cutoff Largest distance to report.
+ * @param visitor Returns the cutoff for the rest of the candidates.
+ * @param context Passed through to the visitor.
+ * @return Number of candidates measured.
+ */
+int deleteIndexFind(const DeleteIndex* index, EditDistance* engine,
+                    const EditDistancePattern* pattern, int cutoff,
+                    EditBatchVisitor visitor, void* context)
+{
+    assert(index);
+    assert(pattern);
+    assert(visitor);
+
+    int limit = cutoff < index->maxDistance ? cutoff : index->maxDistance;
+    if (limit < 0)
+    {
+        return 0;
+    }
+
+    int stride = pattern->length + 1;
+    char* buffers = malloc(stride * (limit + 1));
+    DeleteQuery query;
+    query.index = index;
+    query.count = 0;
+    query.capacity = 64;
+    query.candidates = malloc(sizeof(int) * query.capacity);
+    assert(buffers && query.candidates);
+    memcpy(buffers, pattern->string, pattern->length);
+    buffers[pattern->length] = '\0';
+    deleteIndexVariants(buffers, stride, pattern->length, 0, limit,
+                        deleteQueryVisit, &query);
+    free(buffers);
+
+    qsort(query.candidates, query.count, sizeof(int), deleteIndexCompare);
+    int measured = 0;
+    for (int i = 0; i < query.count; i++)
+    {
+        int word = query.candidates[i];
+        if (i > 0 && word == query.candidates[i - 1])
+        {
+            continue;
+        }
+        measured++;
+        int distance = editDistancePattern(engine, pattern,
+                                           index->words[word],
+                                           index->lengths[word], limit);
+        if (distance <= limit)
+        {
+            cutoff = visitor(word, distance, context);
+            if (cutoff < limit)
+            {
+                limit = cutoff;
+            }
+            if (limit < 0)
+            {
+                break;
+            }
+        }
+    }
+    free(query.candidates);
+    return measured;
+}
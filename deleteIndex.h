@@ -0,0 +1,51 @@
+#ifndef DELETE_INDEX_H
+#define DELETE_INDEX_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "hashMap.h"
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+
+// Most characters a delete index removes from each word; the number of
+// variants grows about as fast as the word length to this power.
+#define DELETE_INDEX_MAX_DISTANCE 3
+
+typedef struct DeleteIndex DeleteIndex;
+
+/*
+ * Every variant of a word list with up to maxDistance characters deleted,
+ * mapped back to the words it came from. Two words are at most d edits
+ * apart only if deleting at most d characters from each gives the same
+ * string, so the words near a query are found by looking up the query's
+ * own variants instead of measuring every word.
+ */
+struct DeleteIndex
+{
+    // Words the index was built from, not copied.
+    const char** words;
+    const int* lengths;
+    int size;
+    int maxDistance;
+    // Each variant, mapped to its list of words.
+    HashMap* variants;
+    // List i holds the word indices from lists[starts[i]] up to but not
+    // including lists[starts[i + 1]], in increasing order.
+    int* starts;
+    int* lists;
+    int numLists;
+    // Total length of all the lists.
+    int numPostings;
+};
+
+void deleteIndexInit(DeleteIndex* index, const char** words,
+                     const int* lengths, int size, int maxDistance);
+void deleteIndexCleanUp(DeleteIndex* index);
+int deleteIndexFind(const DeleteIndex* index, EditDistance* engine,
+                    const EditDistancePattern* pattern, int cutoff,
+                    EditBatchVisitor visitor, void* context);
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "dictionary.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+/*
+ * determine if a character can be part of a word. words are runs of
+ * letters, digits and apostrophes; everything else separates them
+ * @param c
+ * @return 1 if c is a word character, 0 otherwise
+ */
+static int isWordChar(int c) {
+	return (c >= '0' && c <= '9') ||
+		   (c >= 'A' && c <= 'Z') ||
+		   (c >= 'a' && c <= 'z') ||
+		   c == '\'';
+}
+
+/**
+ * Allocates a string for the next word in the file and returns it. This string
+ * is null terminated. Returns NULL after reaching the end of the file.
+ * @param file
+ * @return Allocated string or NULL.
+ */
+char* nextWord(FILE* file)
+{
+    int maxLength = 16;
+    int length = 0;
+    char* word = malloc(sizeof(char) * maxLength);
+    while (1)
+    {
+        char c = fgetc(file);
+        if (isWordChar(c))
+        {
+            if (length + 1 >= maxLength)
+            {
+                maxLength *= 2;
+                word = realloc(word, maxLength);
+            }
+            word[length] = c;
+            length++;
+        }
+        else if (length > 0 || c == EOF)
+        {
+            break;
+        }
+    }
+    if (length == 0)
+    {
+        free(word);
+        return NULL;
+    }
+    word[length] = '\0';
+    return word;
+}
+
+/*
+ * read the rest of the file into one buffer owned by the map, followed by
+ * a null byte. seekable files are read with a single fread straight into
+ * the buffer; other streams are gathered in blocks and copied over
+ * @param file
+ * @param map
+ * @param length set to the number of bytes read
+ * @return the buffer
+ */
+static char * readDictionary(FILE * file, HashMap * map, size_t * length) {
+	char * buffer = NULL;
+	char * temp = NULL;
+	size_t capacity = BATCH_BLOCK_SIZE;
+	size_t count;
+	long start = ftell(file);
+	long end = -1;
+	
+	if (start >= 0 && fseek(file, 0, SEEK_END) == 0) {
+		end = ftell(file);
+		if (fseek(file, start, SEEK_SET) != 0) end = -1;
+	}
+	if (end >= start && start >= 0) {
+		buffer = hashMapKeyBuffer(map, end - start + 1);
+		*length = fread(buffer, 1, end - start, file);
+		buffer[*length] = '\0';
+		return buffer;
+	}
+	
+	*length = 0;
+	temp = malloc(capacity);
+	assert(temp);
+	while ((count = fread(temp + *length, 1, capacity - *length, file)) > 0) {
+		*length += count;
+		if (*length == capacity) {
+			capacity *= 2;
+			temp = realloc(temp, capacity);
+			assert(temp);
+		}
+	}
+	buffer = hashMapKeyBuffer(map, *length + 1);
+	memcpy(buffer, temp, *length);
+	buffer[*length] = '\0';
+	free(temp);
+	return buffer;
+}
+
+/*
+ * read the count a frequency list gives after a word: spaces or tabs, then
+ * digits that end the line (trailing spaces or tabs aside). counts too big
+ * for an int are capped at INT_MAX
+ * @param buffer
+ * @param i position of the separator after the word
+ * @param length number of characters in buffer
+ * @param count set to the count, or to 0 if there is none
+ * @return position of the end of the line after the count, or i if there
+ *         is no count
+ */
+static size_t readCount(const char * buffer, size_t i, size_t length,
+		int * count) {
+	size_t j = i;
+	size_t digits;
+	long long value = 0;
+	
+	*count = 0;
+	while (j < length && (buffer[j] == ' ' || buffer[j] == '\t')) ++j;
+	digits = j;
+	while (j < length && buffer[j] >= '0' && buffer[j] <= '9') {
+		if (value <= INT_MAX) value = value * 10 + (buffer[j] - '0');
+		++j;
+	}
+	if (j == digits || digits == i) return i;
+	while (j < length && (buffer[j] == ' ' || buffer[j] == '\t')) ++j;
+	if (j < length && buffer[j] != '\r' && buffer[j] != '\n') return i;
+	*count = value < INT_MAX ? (int)value : INT_MAX;
+	return j;
+}
+
+/**
+ * Loads the contents of the file into the hash map. The whole file is read
+ * into a buffer owned by the map and split into words in place (same rules
+ * as nextWord()): each word is null terminated where its separator was and
+ * inserted without copying, so nothing is allocated per word. The words are
+ * counted first so the table is sized once up front. Every word gets 0 as
+ * its value, unless counts are read: then a word followed on its line by a
+ * count, as in a frequency list, gets the count, which ranks it among
+ * suggestions at the same distance, and a word listed twice keeps its
+ * larger count.
+ * @param file
+ * @param map
+ * @param counts 1 to read a count after each word, 0 to take every run of
+ *        word characters, digits alone included, as a word.
+ */
+void loadDictionary(FILE* file, HashMap* map, int counts)
+{
+    // FIXME: implement
+	assert(file);
+	assert(map);
+	size_t length;
+	char * buffer = readDictionary(file, map, &length);
+	char * word = NULL;
+	int numWords = 0;
+	int inWord = 0;
+	int count = 0;
+	
+	for (size_t i = 0; i < length; ++i) {
+		if (isWordChar(buffer[i])) {
+			numWords += !inWord;
+			inWord = 1;
+		}
+		else {
+			if (inWord && counts) i = readCount(buffer, i, length, &count);
+			inWord = 0;
+		}
+	}
+	hashMapReserve(map, hashMapSize(map) + numWords);
+	
+	// the null byte after the data ends the last word
+	for (size_t i = 0; i <= length; ++i) {
+		if (i < length && isWordChar(buffer[i])) {
+			if (!word) word = buffer + i;
+		}
+		else if (word) {
+			size_t end = counts ? readCount(buffer, i, length, &count) : i;
+			int * value;
+			buffer[i] = '\0';
+			value = hashMapFindOrInsertBorrowed(map, word, count);
+			if (*value < count) *value = count;
+			word = NULL;
+			i = end;
+		}
+	}
+}
+
+/*
+ * look a lower case word up in the dictionary
+ * @param map
+ * @param dawg graph of the dictionary to walk instead of the map, or NULL
+ * @param word
+ * @return 1 if the word is in the dictionary, 0 otherwise
+ */
+int isWord(HashMap * map, const Dawg * dawg, const char * word) {
+	if (dawg) {
+		return dawgFind(dawg, word, strlen(word)) >= 0;
+	}
+	return hashMapContainsKey(map, word);
+}
+
+/*
+ * write one batch result record and report whether the word is misspelled
+ * @param map
+ * @param dawg graph to look the word up in instead of the map, or NULL
+ * @param output
+ * @param name label for the input the word came from
+ * @param line line number the word starts on
+ * @param column column the word starts in
+ * @param word word as it appears in the input
+ * @param lowerCaseWord lower case copy of word used for the lookup
+ * @return 1 if the word is misspelled, 0 otherwise
+ */
+static int reportWord(HashMap * map, const Dawg * dawg, FILE * output,
+					  const char * name, long line, long column,
+					  const char * word, const char * lowerCaseWord) {
+	int found = isWord(map, dawg, lowerCaseWord);
+	fprintf(output, "%s\t%ld\t%ld\t%s\t%s\n", name, line, column, word,
+			found ? "ok" : "misspelled");
+	return !found;
+}
+
+/*
+ * check every word in file against the dictionary, writing one tab
+ * separated record per word to output:
+ *     <name> <line> <column> <word> <ok|misspelled>
+ * lines and columns count from 1, columns in bytes. words are split with
+ * the same rules as nextWord() and checked case
+ * insensitively. the input is read in large blocks and the word buffers
+ * are reused, so nothing is allocated per word
+ * @param file
+ * @param name label written in the first column of each record
+ * @param map
+ * @param dawg graph to look words up in instead of the map, or NULL
+ * @param output
+ * @return number of misspelled words found
+ */
+long checkFile(FILE * file, const char * name, HashMap * map,
+			   const Dawg * dawg, FILE * output) {
+	assert(file);
+	assert(map || dawg);
+	assert(output);
+	
+	char block[BATCH_BLOCK_SIZE];
+	size_t count;
+	int maxLength = 64;
+	int length = 0;
+	char * word = malloc(sizeof(char) * maxLength);
+	char * lowerCaseWord = malloc(sizeof(char) * maxLength);
+	assert(word);
+	assert(lowerCaseWord);
+	long line = 1;
+	long column = 0;
+	long wordLine = 1;
+	long wordColumn = 1;
+	long misspelled = 0;
+	
+	while ((count = fread(block, 1, sizeof(block), file)) > 0) {
+		for (size_t i = 0; i < count; ++i) {
+			char c = block[i];
+			++column;
+			if (isWordChar(c)) {
+				if (length + 1 >= maxLength) {
+					maxLength *= 2;
+					word = realloc(word, maxLength);
+					lowerCaseWord = realloc(lowerCaseWord, maxLength);
+					assert(word);
+					assert(lowerCaseWord);
+				}
+				if (length == 0) {
+					wordLine = line;
+					wordColumn = column;
+				}
+				word[length] = c;
+				lowerCaseWord[length] = tolower(c);
+				++length;
+			}
+			else {
+				if (length > 0) {
+					word[length] = '\0';
+					lowerCaseWord[length] = '\0';
+					misspelled += reportWord(map, dawg, output, name,
+											 wordLine, wordColumn, word,
+											 lowerCaseWord);
+					length = 0;
+				}
+				if (c == '\n') {
+					++line;
+					column = 0;
+				}
+			}
+		}
+	}
+	
+	// the input may end in the middle of a word
+	if (length > 0) {
+		word[length] = '\0';
+		lowerCaseWord[length] = '\0';
+		misspelled += reportWord(map, dawg, output, name, wordLine,
+								 wordColumn, word, lowerCaseWord);
+	}
+	
+	free(word);
+	free(lowerCaseWord);
+	return misspelled;
+}
+
+/*
+ * check each named file, or input for "-" or when no files are given,
+ * against the dictionary and write the records of checkFile() to output.
+ * files that cannot be opened are reported on stderr and skipped
+ * @param map
+ * @param dawg graph to look words up in instead of the map, or NULL
+ * @param numFiles
+ * @param fileNames
+ * @param input stream read for "-"
+ * @param output
+ * @return 0 if every input could be read, 1 otherwise
+ */
+int checkFiles(HashMap * map, const Dawg * dawg, int numFiles,
+			   const char ** fileNames, FILE * input, FILE * output) {
+	int status = 0;
+	FILE * file = NULL;
+	
+	if (numFiles == 0) {
+		checkFile(input, "-", map, dawg, output);
+	}
+	for (int i = 0; i < numFiles; ++i) {
+		if (strcmp(fileNames[i], "-") == 0) {
+			checkFile(input, "-", map, dawg, output);
+			continue;
+		}
+		file = fopen(fileNames[i], "r");
+		if (!file) {
+			fprintf(stderr, "Could not open %s\n", fileNames[i]);
+			status = 1;
+			continue;
+		}
+		checkFile(file, fileNames[i], map, dawg, output);
+		fclose(file);
+	}
+	return status;
+}
@@ -0,0 +1,24 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "hashMap.h"
+#include "dawg.h"
+#include <stdio.h>
+
+// Size of the blocks word lists and checked files are read in.
+#define BATCH_BLOCK_SIZE 65536
+
+char* nextWord(FILE* file);
+void loadDictionary(FILE* file, HashMap* map, int counts);
+int isWord(HashMap* map, const Dawg* dawg, const char* word);
+long checkFile(FILE* file, const char* name, HashMap* map, const Dawg* dawg,
+               FILE* output);
+int checkFiles(HashMap* map, const Dawg* dawg, int numFiles,
+               const char** fileNames, FILE* input, FILE* output);
+
+#endif
@@ -0,0 +1,469 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "editDistance.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * calculate and return the levenshtein distance between 2 strings.
+ * Based on pseudocode from https://en.wikipedia.org/wiki/Levenshtein_distance#Iterative_with_two_matrix_rows
+ * @param string1
+ * @param string2
+ * @return levenshtein distance between string1 and string2
+ */
+int levenshtein(const char * string1, const char * string2) {
+	const int NUM_VECTORS = 2;
+	int * vectors[NUM_VECTORS];
+	int * temp = NULL;
+	int length1 = strlen(string1);
+	int length2 = strlen(string2);
+	int vecLength = length2 + 1;
+	int levDist = 0;
+	
+	int del, ins, sub, min;
+	
+	// allocate the two vectors to use
+	for (int i = 0; i < NUM_VECTORS; ++i) {
+		vectors[i] = malloc(sizeof(int) * vecLength);
+		assert(vectors[i]);
+	}
+	
+	/*
+	 * initialize vector0 to the levenshtien disances of string2's
+	 * substrings from a null string
+	 */
+	for (int i = 0; i < vecLength; ++i) {
+		vectors[0][i] = i;
+	}
+	
+	for (int i = 0; i < length1; ++i) {
+		/*
+		 * calculate vector1 from vector0. vector1 represents the
+		 * levenshtein distance between substrings for string1 and substrings
+		 * of string2. the results of the previous substring of string1 are
+		 * in vector0
+		 */
+		
+		//first element is between substrings of 1 and null string
+		vectors[1][0] = i + 1;
+		
+		//subsequent elements based on needed edit
+		for (int j = 0; j < length2; ++j) {
+			del = vectors[0][j+1] + 1; //deletion edit
+			ins = vectors[1][j] + 1; //insertion edit
+			//substituion edit
+			if (string1[i] == string2[j]) sub = vectors[0][j];
+			else sub = vectors[0][j] + 1;
+			
+			//determine minimum edit distance
+			min = del;
+			if (ins < min) min = ins;
+			if (sub < min) min = sub;
+			vectors[1][j + 1] = min;
+		}
+		
+		/*
+		 * swap vetors to preserve vector0 as previous iteration and
+		 * vector1 as working space.
+		 */
+		temp = vectors[0];
+		vectors[0] = vectors[1];
+		vectors[1] = temp;
+		temp = NULL;
+	}
+	
+	// distance between full strings is last element in vector0
+	levDist = vectors[0][length2];
+	
+	for (int i = 0; i < NUM_VECTORS; ++i) {
+		free(vectors[i]);
+		vectors[i] = NULL;
+	}
+	
+	return levDist;
+}
+
+
+/*
+ * Defines a function that computes the edit distance with a single row of
+ * cells of the given type, which must hold values up to the length of
+ * string1. The row must have room for length2 + 1 cells.
+ */
+#define EDIT_DISTANCE_ROW(name, cell)                                      \
+static int name(cell* row, const char* string1, int length1,               \
+                const char* string2, int length2)                          \
+{                                                                          \
+    for (int j = 0; j <= length2; j++)                                     \
+    {                                                                      \
+        row[j] = j;                                                        \
+    }                                                                      \
+    for (int i = 0; i < length1; i++)                                      \
+    {                                                                      \
+        /* row[j] still holds the previous row until it is overwritten */  \
+        int diagonal = row[0];                                             \
+        char c = string1[i];                                               \
+        row[0] = i + 1;                                                    \
+        for (int j = 0; j < length2; j++)                                  \
+        {                                                                  \
+            int above = row[j + 1];                                        \
+            int best = diagonal + (c != string2[j]);                       \
+            if (above + 1 < best)                                          \
+            {                                                              \
+                best = above + 1;                                          \
+            }                                                              \
+            if (row[j] + 1 < best)                                         \
+            {                                                              \
+                best = row[j] + 1;                                         \
+            }                                                              \
+            row[j + 1] = best;                                             \
+            diagonal = above;                                              \
+        }                                                                  \
+    }                                                                      \
+    return row[length2];                                                   \
+}
+
+EDIT_DISTANCE_ROW(editDistanceRow8, uint8_t)
+EDIT_DISTANCE_ROW(editDistanceRow16, uint16_t)
+EDIT_DISTANCE_ROW(editDistanceRow32, int32_t)
+
+/**
+ * Computes the edit distance, or cutoff + 1 if it is more than cutoff, by
+ * filling only the band of cells at most cutoff away from the diagonal.
+ * Cells outside the band are taken to be cutoff + 1, and the walk stops as
+ * soon as a whole row exceeds the cutoff, since no later row can then get
+ * back under it. string1 must be the longer string, at most cutoff longer
+ * than string2, and the cutoff must be below UINT8_MAX.
+ * @param row Room for length2 + 1 cells.
+ * @param string1
+ * @param length1
+ * @param string2
+ * @param length2
+ * @param cutoff
+ * @return Distance, or cutoff + 1.
+ */
+static int editDistanceBand(uint8_t* row, const char* string1, int length1,
+                            const char* string2, int length2, int cutoff)
+{
+    int over = cutoff + 1;
+    for (int j = 0; j <= length2; j++)
+    {
+        row[j] = j <= cutoff ? j : over;
+    }
+    for (int i = 1; i <= length1; i++)
+    {
+        int first = i - cutoff > 1 ? i - cutoff : 1;
+        int last = i + cutoff < length2 ? i + cutoff : length2;
+        int diagonal = row[first - 1];
+        int left = first == 1 && i <= cutoff ? i : over;
+        int rowMin = left;
+        char c = string1[i - 1];
+        row[first - 1] = left;
+        /*
+         * row[j] still holds the previous row; past that row's band it is
+         * still the over value it started with
+         */
+        for (int j = first; j <= last; j++)
+        {
+            int above = row[j];
+            int best = diagonal + (c != string2[j - 1]);
+            if (above + 1 < best)
+            {
+                best = above + 1;
+            }
+            if (left + 1 < best)
+            {
+                best = left + 1;
+            }
+            if (best > over)
+            {
+                best = over;
+            }
+            row[j] = best;
+            diagonal = above;
+            left = best;
+            if (best < rowMin)
+            {
+                rowMin = best;
+            }
+        }
+        if (rowMin > cutoff)
+        {
+            return over;
+        }
+    }
+    return row[length2];
+}
+
+/**
+ * Makes sure the engine's scratch row has at least the given size.
+ * @param engine
+ * @param rowBytes
+ */
+static void editDistanceReserve(EditDistance* engine, size_t rowBytes)
+{
+    if (rowBytes > engine->rowBytes)
+    {
+        free(engine->row);
+        engine->row = malloc(rowBytes);
+        assert(engine->row);
+        engine->rowBytes = rowBytes;
+    }
+}
+
+/**
+ * Sets up empty scratch memory. It grows on demand while computing.
+ * @param engine
+ */
+void editDistanceInit(EditDistance* engine)
+{
+    assert(engine);
+    engine->row = NULL;
+    engine->rowBytes = 0;
+    engine->lanes = NULL;
+    engine->laneBytes = 0;
+}
+
+/**
+ * Frees the scratch memory.
+ * @param engine
+ */
+void editDistanceCleanUp(EditDistance* engine)
+{
+    assert(engine);
+    free(engine->row);
+    free(engine->lanes);
+    engine->row = NULL;
+    engine->rowBytes = 0;
+    engine->lanes = NULL;
+    engine->laneBytes = 0;
+}
+
+/**
+ * Computes the levenshtein distance between two strings of known length,
+ * giving the same result as levenshtein(). The strings need not be null
+ * terminated. Only one row of the matrix is kept, along the shorter
+ * string, in the engine's scratch memory and with the narrowest cells
+ * that can hold the result, so nothing is allocated once the scratch
+ * memory is big enough.
+ * @param engine Scratch memory used by the calling thread.
+ * @param string1
+ * @param length1 Number of characters in string1.
+ * @param string2
+ * @param length2 Number of characters in string2.
+ * @return Edit distance between the strings.
+ */
+int editDistance(EditDistance* engine, const char* string1, int length1,
+                 const char* string2, int length2)
+{
+    assert(engine);
+    assert(length1 >= 0 && length2 >= 0);
+    
+    // the distance is symmetric, so keep the row along the shorter string
+    if (length2 > length1)
+    {
+        const char* string = string1;
+        int length = length1;
+        string1 = string2;
+        length1 = length2;
+        string2 = string;
+        length2 = length;
+    }
+    
+    // no cell can exceed the longer length
+    size_t cellBytes = length1 <= UINT8_MAX ? sizeof(uint8_t)
+                       : length1 <= UINT16_MAX ? sizeof(uint16_t)
+                       : sizeof(int32_t);
+    editDistanceReserve(engine, cellBytes * (length2 + 1));
+    
+    if (cellBytes == sizeof(uint8_t))
+    {
+        return editDistanceRow8(engine->row, string1, length1,
+                                string2, length2);
+    }
+    if (cellBytes == sizeof(uint16_t))
+    {
+        return editDistanceRow16(engine->row, string1, length1,
+                                 string2, length2);
+    }
+    return editDistanceRow32(engine->row, string1, length1,
+                             string2, length2);
+}
+
+/**
+ * Computes the levenshtein distance between two strings of known length
+ * when it is at most the cutoff. Pairs whose lengths differ by more than
+ * the cutoff are rejected without looking at them, and otherwise only the
+ * band of the matrix that can stay within the cutoff is filled, stopping
+ * at the first row that cannot.
+ * @param engine Scratch memory used by the calling thread.
+ * @param string1
+ * @param length1 Number of characters in string1.
+ * @param string2
+ * @param length2 Number of characters in string2.
+ * @param cutoff Largest distance of interest, at least 0.
+ * @return Edit distance between the strings if it is at most cutoff,
+ *         otherwise cutoff + 1.
+ */
+int editDistanceBounded(EditDistance* engine, const char* string1,
+                        int length1, const char* string2, int length2,
+                        int cutoff)
+{
+    assert(engine);
+    assert(length1 >= 0 && length2 >= 0);
+    assert(cutoff >= 0);
+    
+    if (length2 > length1)
+    {
+        const char* string = string1;
+        int length = length1;
+        string1 = string2;
+        length1 = length2;
+        string2 = string;
+        length2 = length;
+    }
+    if (length1 - length2 > cutoff)
+    {
+        return cutoff + 1;
+    }
+    
+    // the band covers the whole matrix, or would not fit narrow cells
+    if (cutoff >= length1 || cutoff >= UINT8_MAX - 1)
+    {
+        int distance = editDistance(engine, string1, length1,
+                                    string2, length2);
+        return distance <= cutoff ? distance : cutoff + 1;
+    }
+    
+    editDistanceReserve(engine, length2 + 1);
+    return editDistanceBand(engine->row, string1, length1,
+                            string2, length2, cutoff);
+}
+
+/**
+ * Sums up which characters a string uses in one word: bit c % 64 is set
+ * for every character c. Every character one string has in a bit the
+ * other has nothing in costs at least one edit, so two masks bound the
+ * distance between their strings from below without measuring it.
+ * @param string
+ * @param length Number of characters in string.
+ * @return The mask.
+ */
+uint64_t editDistanceCharacters(const char* string, int length)
+{
+    assert(string);
+    uint64_t mask = 0;
+    for (int i = 0; i < length; i++)
+    {
+        mask |= (uint64_t)1 << ((unsigned char)string[i] % 64);
+    }
+    return mask;
+}
+
+/**
+ * Prepares the string for editDistancePattern by recording, for every
+ * character, the positions where the string has it, and which characters
+ * it uses.
+ * @param pattern
+ * @param string
+ * @param length Number of characters in string.
+ */
+void editDistancePatternInit(EditDistancePattern* pattern, const char* string,
+                             int length)
+{
+    assert(pattern);
+    assert(length >= 0);
+    pattern->string = string;
+    pattern->length = length;
+    pattern->characters = editDistanceCharacters(string, length);
+    memset(pattern->match, 0, sizeof(pattern->match));
+    if (length > EDIT_PATTERN_MAX_LENGTH)
+    {
+        return;
+    }
+    for (int i = 0; i < length; i++)
+    {
+        pattern->match[(unsigned char)string[i]] |= (uint64_t)1 << i;
+    }
+}
+
+/**
+ * Computes the levenshtein distance between the pattern's string and
+ * another string when it is at most the cutoff, giving the same result as
+ * editDistanceBounded. Patterns of up to EDIT_PATTERN_MAX_LENGTH characters
+ * use the bit-parallel algorithm of Myers as formulated by Hyyro: a whole
+ * column of the matrix is kept as bit vectors of +1 and -1 differences
+ * between vertically adjacent cells and advanced by one character of the
+ * other string with a handful of word operations. Only the bottom cell is
+ * tracked exactly; the walk stops once it is too far above the cutoff for
+ * the remaining characters to bring it back down. Longer patterns are
+ * measured with editDistanceBounded.
+ * @param engine Scratch memory used by the calling thread, only needed for
+ *        long patterns.
+ * @param pattern
+ * @param string
+ * @param length Number of characters in string.
+ * @param cutoff Largest distance of interest, at least 0.
+ * @return Edit distance between the strings if it is at most cutoff,
+ *         otherwise cutoff + 1.
+ */
+int editDistancePattern(EditDistance* engine,
+                        const EditDistancePattern* pattern,
+                        const char* string, int length, int cutoff)
+{
+    assert(pattern);
+    assert(length >= 0);
+    assert(cutoff >= 0);
+    
+    int patternLength = pattern->length;
+    if (patternLength > EDIT_PATTERN_MAX_LENGTH)
+    {
+        return editDistanceBounded(engine, pattern->string, patternLength,
+                                   string, length, cutoff);
+    }
+    if (patternLength - length > cutoff || length - patternLength > cutoff)
+    {
+        return cutoff + 1;
+    }
+    if (patternLength == 0)
+    {
+        return length;
+    }
+    
+    uint64_t last = (uint64_t)1 << (patternLength - 1);
+    // the first column is 0, 1, 2, ... so every vertical step is +1
+    uint64_t plus = ~(uint64_t)0;
+    uint64_t minus = 0;
+    int score = patternLength;
+    for (int j = 0; j < length; j++)
+    {
+        uint64_t match = pattern->match[(unsigned char)string[j]];
+        uint64_t vertical = match | minus;
+        uint64_t horizontal = (((match & plus) + plus) ^ plus) | match;
+        uint64_t plusH = minus | ~(horizontal | plus);
+        uint64_t minusH = plus & horizontal;
+        if (plusH & last)
+        {
+            score++;
+        }
+        else if (minusH & last)
+        {
+            score--;
+        }
+        // each remaining character can lower the bottom cell by at most one
+        if (score - (length - j - 1) > cutoff)
+        {
+            return cutoff + 1;
+        }
+        // the top row is 0, 1, 2, ... so its horizontal step is +1
+        plusH = (plusH << 1) | 1;
+        minusH <<= 1;
+        plus = minusH | ~(vertical | plusH);
+        minus = plusH & vertical;
+    }
+    return score <= cutoff ? score : cutoff + 1;
+}
@@ -0,0 +1,66 @@
+#ifndef EDIT_DISTANCE_H
+#define EDIT_DISTANCE_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest pattern the bit-parallel kernel handles; one bit per character.
+#define EDIT_PATTERN_MAX_LENGTH 64
+
+typedef struct EditDistance EditDistance;
+typedef struct EditDistancePattern EditDistancePattern;
+
+/*
+ * Scratch memory for computing edit distances without allocating on every
+ * call. Each thread computing distances needs its own; set one up with
+ * editDistanceInit and release it with editDistanceCleanUp.
+ */
+struct EditDistance
+{
+    // One row of the dynamic programming matrix, reused between calls.
+    void* row;
+    // Number of bytes allocated for row.
+    size_t rowBytes;
+    // Rows of byte lanes used by editDistanceBatchScan.
+    void* lanes;
+    size_t laneBytes;
+};
+
+/*
+ * A query word prepared for measuring against many other words with
+ * editDistancePattern. Set up once per query with editDistancePatternInit;
+ * it points at the word rather than copying it.
+ */
+struct EditDistancePattern
+{
+    const char* string;
+    int length;
+    // Characters of the string, as editDistanceCharacters sums them up.
+    uint64_t characters;
+    // Bit i of match[c] is set when character i of the string is c.
+    uint64_t match[256];
+};
+
+int levenshtein(const char* string1, const char* string2);
+
+void editDistanceInit(EditDistance* engine);
+void editDistanceCleanUp(EditDistance* engine);
+int editDistance(EditDistance* engine, const char* string1, int length1,
+                 const char* string2, int length2);
+int editDistanceBounded(EditDistance* engine, const char* string1,
+                        int length1, const char* string2, int length2,
+                        int cutoff);
+
+uint64_t editDistanceCharacters(const char* string, int length);
+void editDistancePatternInit(EditDistancePattern* pattern, const char* string,
+                             int length);
+int editDistancePattern(EditDistance* engine,
+                        const EditDistancePattern* pattern,
+                        const char* string, int length, int cutoff);
+
+#endif
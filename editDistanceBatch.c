@@ -0,0 +1,640 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "editDistanceBatch.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The vector kernels are built with per-function target attributes and
+// picked at run time, so the rest of the program needs no special flags.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDIT_BATCH_X86
+#include <immintrin.h>
+#endif
+
+#ifdef EDIT_BATCH_X86
+
+/**
+ * Measures the query against every lane of a group with 32 byte lanes per
+ * instruction. Cells saturate at 255, which is over any cutoff a vector
+ * kernel is used with. Stops early once every lane's row is over the
+ * cutoff.
+ * @param characters Row 0 of the group.
+ * @param length Length of the group's words.
+ * @param padding 0xff for lanes without a word, 0 for the others.
+ * @param query
+ * @param queryLength
+ * @param cutoff Below 255.
+ * @param rows Room for queryLength + 1 rows of 32 bytes.
+ * @param distances Set to each lane's distance, or to 255 if it is over
+ *        the cutoff.
+ */
+__attribute__((target("avx2")))
+static void editBatchGroupAvx2(const uint8_t* characters, int length,
+                               const uint8_t* padding, const char* query,
+                               int queryLength, int cutoff, uint8_t* rows,
+                               uint8_t* distances)
+{
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i over = _mm256_set1_epi8((char)(cutoff + 1));
+    const __m256i pad = _mm256_loadu_si256((const __m256i*)padding);
+
+    for (int j = 0; j <= queryLength; j++)
+    {
+        __m256i cell = _mm256_set1_epi8((char)(j < 255 ? j : 255));
+        _mm256_storeu_si256((__m256i*)(rows + j * 32),
+                            _mm256_or_si256(cell, pad));
+    }
+    for (int i = 0; i < length; i++)
+    {
+        __m256i c = _mm256_loadu_si256(
+            (const __m256i*)(characters + i * EDIT_BATCH_LANES));
+        __m256i diagonal = _mm256_loadu_si256((const __m256i*)rows);
+        __m256i left = _mm256_or_si256(
+            _mm256_set1_epi8((char)(i + 1 < 255 ? i + 1 : 255)), pad);
+        __m256i rowMin = left;
+        _mm256_storeu_si256((__m256i*)rows, left);
+        for (int j = 0; j < queryLength; j++)
+        {
+            __m256i above = _mm256_loadu_si256(
+                (const __m256i*)(rows + (j + 1) * 32));
+            __m256i mismatch = _mm256_andnot_si256(
+                _mm256_cmpeq_epi8(c, _mm256_set1_epi8(query[j])), one);
+            __m256i best = _mm256_adds_epu8(diagonal, mismatch);
+            best = _mm256_min_epu8(best, _mm256_adds_epu8(above, one));
+            best = _mm256_min_epu8(best, _mm256_adds_epu8(left, one));
+            _mm256_storeu_si256((__m256i*)(rows + (j + 1) * 32), best);
+            rowMin = _mm256_min_epu8(rowMin, best);
+            diagonal = above;
+            left = best;
+        }
+        // every lane at or past cutoff + 1
+        __m256i done = _mm256_cmpeq_epi8(_mm256_max_epu8(rowMin, over),
+                                         rowMin);
+        if (_mm256_movemask_epi8(done) == -1)
+        {
+            memset(distances, 255, 32);
+            return;
+        }
+    }
+    memcpy(distances, rows + queryLength * 32, 32);
+}
+
+/**
+ * Same as editBatchGroupAvx2 for 16 of a group's lanes.
+ * @param characters Row 0 of the group, offset to the first lane.
+ * @param length
+ * @param padding
+ * @param query
+ * @param queryLength
+ * @param cutoff
+ * @param rows Room for queryLength + 1 rows of 16 bytes.
+ * @param distances
+ */
+__attribute__((target("sse2")))
+static void editBatchGroupSse2(const uint8_t* characters, int length,
+                               const uint8_t* padding, const char* query,
+                               int queryLength, int cutoff, uint8_t* rows,
+                               uint8_t* distances)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i over = _mm_set1_epi8((char)(cutoff + 1));
+    const __m128i pad = _mm_loadu_si128((const __m128i*)padding);
+
+    for (int j = 0; j <= queryLength; j++)
+    {
+        __m128i cell = _mm_set1_epi8((char)(j < 255 ? j : 255));
+        _mm_storeu_si128((__m128i*)(rows + j * 16), _mm_or_si128(cell, pad));
+    }
+    for (int i = 0; i < length; i++)
+    {
+        __m128i c = _mm_loadu_si128(
+            (const __m128i*)(characters + i * EDIT_BATCH_LANES));
+        __m128i diagonal = _mm_loadu_si128((const __m128i*)rows);
+        __m128i left = _mm_or_si128(
+            _mm_set1_epi8((char)(i + 1 < 255 ? i + 1 : 255)), pad);
+        __m128i rowMin = left;
+        _mm_storeu_si128((__m128i*)rows, left);
+        for (int j = 0; j < queryLength; j++)
+        {
+            __m128i above = _mm_loadu_si128(
+                (const __m128i*)(rows + (j + 1) * 16));
+            __m128i mismatch = _mm_andnot_si128(
+                _mm_cmpeq_epi8(c, _mm_set1_epi8(query[j])), one);
+            __m128i best = _mm_adds_epu8(diagonal, mismatch);
+            best = _mm_min_epu8(best, _mm_adds_epu8(above, one));
+            best = _mm_min_epu8(best, _mm_adds_epu8(left, one));
+            _mm_storeu_si128((__m128i*)(rows + (j + 1) * 16), best);
+            rowMin = _mm_min_epu8(rowMin, best);
+            diagonal = above;
+            left = best;
+        }
+        __m128i done = _mm_cmpeq_epi8(_mm_max_epu8(rowMin, over), rowMin);
+        if (_mm_movemask_epi8(done) == 0xffff)
+        {
+            memset(distances, 255, 16);
+            return;
+        }
+    }
+    memcpy(distances, rows + queryLength * 16, 16);
+}
+
+#endif
+
+/**
+ * Determines whether the processor can run the kernel.
+ * @param kernel
+ * @return 1 if it can, 0 if not.
+ */
+static int editBatchKernelSupported(EditBatchKernel kernel)
+{
+    switch (kernel)
+    {
+    case EDIT_BATCH_SCALAR:
+        return 1;
+#ifdef EDIT_BATCH_X86
+    case EDIT_BATCH_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case EDIT_BATCH_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @param mask
+ * @return Number of bits set in the mask.
+ */
+static int editBatchPopCount(uint64_t mask)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+
+/*
+ * Defines a function that works out which words of a group can be within
+ * the cutoff of the pattern from their lengths and character masks alone,
+ * counting bits with the given function. Every edit removes at most one of
+ * the characters the pattern has over the word, and at most one of those
+ * the word has over the pattern. There are at least as many of each as
+ * bits only that side's mask has, and the two counts differ by the
+ * difference in length. Words with an index above ties must be under the
+ * cutoff rather than within it. Nothing can be ruled out while a word's
+ * cutoff is as long as both strings, so the masks are not looked at then.
+ * Sets padding to 0 for the lanes left and 0xff for the rest, and returns
+ * the number of lanes left.
+ */
+#define EDIT_BATCH_FILTER(name, popcount)                                  \
+static int name(const EditDistanceBatch* batch,                            \
+                const EditBatchGroup* group,                               \
+                const EditDistancePattern* pattern, int cutoff, int ties,  \
+                uint8_t* padding)                                          \
+{                                                                          \
+    int gap = pattern->length - group->length;                             \
+    int longest = gap >= 0 ? pattern->length : group->length;              \
+    int open = 0;                                                          \
+    for (int lane = 0; lane < EDIT_BATCH_LANES; lane++)                    \
+    {                                                                      \
+        padding[lane] = 0xff;                                              \
+        if (lane >= group->count)                                          \
+        {                                                                  \
+            continue;                                                      \
+        }                                                                  \
+        int word = group->first + lane;                                    \
+        int within = cutoff - (batch->index[word] > ties);                 \
+        if (within < longest)                                              \
+        {                                                                  \
+            uint64_t mask = batch->masks[word];                            \
+            int onlyPattern = popcount(pattern->characters & ~mask);       \
+            int onlyWord = popcount(mask & ~pattern->characters);          \
+            /* characters the longer string has over the other */         \
+            int bound = gap >= 0 ? onlyWord + gap : onlyPattern - gap;     \
+            int only = gap >= 0 ? onlyPattern : onlyWord;                  \
+            if ((only > bound ? only : bound) > within)                    \
+            {                                                              \
+                continue;                                                  \
+            }                                                              \
+        }                                                                  \
+        padding[lane] = 0;                                                 \
+        open++;                                                            \
+    }                                                                      \
+    return open;                                                           \
+}
+
+EDIT_BATCH_FILTER(editBatchFilter, editBatchPopCount)
+#ifdef EDIT_BATCH_X86
+__attribute__((target("popcnt")))
+EDIT_BATCH_FILTER(editBatchFilterPopcnt, __builtin_popcountll)
+#endif
+
+/**
+ * @param word
+ * @param length Number of characters in word.
+ * @return Position of the word's length and first character in the
+ *         batch's order.
+ */
+static int editBatchSortKey(const char* word, int length)
+{
+    return length * 256 + (length > 0 ? (uint8_t)word[0] : 0);
+}
+
+/**
+ * Lays out the words for editDistanceBatchScan, sorted by length, then by
+ * first character, and transposed into groups of EDIT_BATCH_LANES, and
+ * picks the fastest kernel and bit count the processor supports. The
+ * words are not copied and must outlive the batch.
+ * @param batch
+ * @param words
+ * @param lengths Number of characters in each word.
+ * @param size Number of words.
+ */
+void editDistanceBatchInit(EditDistanceBatch* batch, const char** words,
+                           const int* lengths, int size)
+{
+    assert(batch);
+    assert(size >= 0);
+
+    int maxLength = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (lengths[i] > maxLength)
+        {
+            maxLength = lengths[i];
+        }
+    }
+
+    // counting sort by length, then first character, keeping the given
+    // order within those
+    int numKeys = (maxLength + 1) * 256;
+    int* starts = calloc(numKeys + 1, sizeof(int));
+    assert(starts);
+    for (int i = 0; i < size; i++)
+    {
+        starts[editBatchSortKey(words[i], lengths[i]) + 1]++;
+    }
+    for (int key = 0; key < numKeys; key++)
+    {
+        starts[key + 1] += starts[key];
+    }
+    batch->size = size;
+    batch->index = malloc(sizeof(int) * (size + 1));
+    batch->words = malloc(sizeof(char*) * (size + 1));
+    batch->lengths = malloc(sizeof(int) * (size + 1));
+    batch->masks = malloc(sizeof(uint64_t) * (size + 1));
+    assert(batch->index && batch->words && batch->lengths && batch->masks);
+    for (int i = 0; i < size; i++)
+    {
+        int position = starts[editBatchSortKey(words[i], lengths[i])]++;
+        batch->index[position] = i;
+        batch->words[position] = words[i];
+        batch->lengths[position] = lengths[i];
+        batch->masks[position] = editDistanceCharacters(words[i], lengths[i]);
+    }
+    free(starts);
+
+    // split each length into groups and count their rows
+    size_t numRows = 0;
+    batch->numGroups = 0;
+    batch->groups = malloc(sizeof(EditBatchGroup)
+                           * (size / EDIT_BATCH_LANES + maxLength + 2));
+    assert(batch->groups);
+    for (int i = 0; i < size; )
+    {
+        EditBatchGroup* group = &batch->groups[batch->numGroups++];
+        group->length = batch->lengths[i];
+        group->first = i;
+        group->count = 0;
+        group->offset = numRows * EDIT_BATCH_LANES;
+        while (i < size && group->count < EDIT_BATCH_LANES
+               && batch->lengths[i] == group->length)
+        {
+            group->count++;
+            i++;
+        }
+        numRows += group->length;
+    }
+    batch->maxLength = maxLength;
+    batch->lengthGroups = malloc(sizeof(int) * (maxLength + 2));
+    assert(batch->lengthGroups);
+    for (int length = 0, g = 0; length <= maxLength + 1; length++)
+    {
+        while (g < batch->numGroups && batch->groups[g].length < length)
+        {
+            g++;
+        }
+        batch->lengthGroups[length] = g;
+    }
+
+    batch->characters = calloc(numRows * EDIT_BATCH_LANES + 1, 1);
+    assert(batch->characters);
+    for (int g = 0; g < batch->numGroups; g++)
+    {
+        EditBatchGroup* group = &batch->groups[g];
+        uint8_t* rows = batch->characters + group->offset;
+        for (int lane = 0; lane < group->count; lane++)
+        {
+            const char* word = batch->words[group->first + lane];
+            for (int i = 0; i < group->length; i++)
+            {
+                rows[i * EDIT_BATCH_LANES + lane] = word[i];
+            }
+        }
+    }
+
+    batch->kernel = EDIT_BATCH_SCALAR;
+    if (!editDistanceBatchUseKernel(batch, EDIT_BATCH_AVX2))
+    {
+        editDistanceBatchUseKernel(batch, EDIT_BATCH_SSE2);
+    }
+    batch->popcnt = 0;
+#ifdef EDIT_BATCH_X86
+    __builtin_cpu_init();
+    batch->popcnt = __builtin_cpu_supports("popcnt");
+#endif
+}
+
+/**
+ * Frees the batch's layout. The words themselves are not touched.
+ * @param batch
+ */
+void editDistanceBatchCleanUp(EditDistanceBatch* batch)
+{
+    assert(batch);
+    free(batch->index);
+    free(batch->words);
+    free(batch->lengths);
+    free(batch->masks);
+    free(batch->groups);
+    free(batch->lengthGroups);
+    free(batch->characters);
+    batch->index = NULL;
+    batch->words = NULL;
+    batch->lengths = NULL;
+    batch->masks = NULL;
+    batch->groups = NULL;
+    batch->lengthGroups = NULL;
+    batch->characters = NULL;
+    batch->size = 0;
+    batch->numGroups = 0;
+}
+
+/**
+ * Switches the batch to the given kernel if the processor supports it.
+ * @param batch
+ * @param kernel
+ * @return 1 if the kernel is now in use, 0 if it is not supported.
+ */
+int editDistanceBatchUseKernel(EditDistanceBatch* batch,
+                               EditBatchKernel kernel)
+{
+    assert(batch);
+    if (!editBatchKernelSupported(kernel))
+    {
+        return 0;
+    }
+    batch->kernel = kernel;
+    return 1;
+}
+
+/**
+ * Measures the pattern against the batch's words, skipping every group
+ * whose length differs from the pattern's by more than the cutoff and
+ * every word whose characters alone put it over the cutoff, and reports
+ * each word within the cutoff to the visitor in batch order. The
+ * visitor returns the cutoff for the rest of the scan, so it can tighten
+ * it as it finds closer words. A visitor that breaks ties at the cutoff
+ * by index can also lower ties as it goes: words whose index in the list
+ * is above it are then only reported when under the cutoff. The vector
+ * kernels measure a whole group at the cutoff it started with; the
+ * scalar kernel and cutoffs of 255 or more measure one word at a time.
+ * Either way the same words are reported with the same distances.
+ * @param engine Scratch memory used by the calling thread.
+ * @param batch
+ * @param pattern The query.
+ * @param cutoff Largest distance to report.
+ * @param ties Read before each word, or NULL to report every word within
+ *        the cutoff.
+ * @param visitor
+ * @param context Passed through to the visitor.
+ * @return The cutoff after the last word.
+ */
+int editDistanceBatchScan(EditDistance* engine,
+                          const EditDistanceBatch* batch,
+                          const EditDistancePattern* pattern, int cutoff,
+                          const int* ties, EditBatchVisitor visitor,
+                          void* context)
+{
+    assert(batch);
+    return editDistanceBatchScanGroups(engine, batch, 0, batch->numGroups,
+                                       pattern, cutoff, ties, visitor,
+                                       context);
+}
+
+/**
+ * Same as editDistanceBatchScan for the groups from first up to but not
+ * including last, so separate threads can scan separate ranges.
+ * @param engine Scratch memory used by the calling thread.
+ * @param batch
+ * @param first
+ * @param last
+ * @param pattern
+ * @param cutoff
+ * @param ties
+ * @param visitor
+ * @param context
+ * @return The cutoff after the last word.
+ */
+int editDistanceBatchScanGroups(EditDistance* engine,
+                                const EditDistanceBatch* batch, int first,
+                                int last, const EditDistancePattern* pattern,
+                                int cutoff, const int* ties,
+                                EditBatchVisitor visitor, void* context)
+{
+    assert(engine);
+    assert(batch);
+    assert(pattern);
+    assert(visitor);
+    assert(first >= 0 && last <= batch->numGroups);
+
+    uint8_t distances[EDIT_BATCH_LANES];
+    uint8_t padding[EDIT_BATCH_LANES];
+    int noTies = INT_MAX;
+    int (*filter)(const EditDistanceBatch*, const EditBatchGroup*,
+                  const EditDistancePattern*, int, int, uint8_t*) =
+        editBatchFilter;
+    size_t laneBytes = (size_t)EDIT_BATCH_LANES * (pattern->length + 1);
+
+    if (batch->kernel != EDIT_BATCH_SCALAR && laneBytes > engine->laneBytes)
+    {
+        free(engine->lanes);
+        engine->lanes = malloc(laneBytes);
+        assert(engine->lanes);
+        engine->laneBytes = laneBytes;
+    }
+    if (!ties)
+    {
+        ties = &noTies;
+    }
+#ifdef EDIT_BATCH_X86
+    if (batch->popcnt)
+    {
+        filter = editBatchFilterPopcnt;
+    }
+#endif
+
+    for (int g = first; g < last && cutoff >= 0; g++)
+    {
+        const EditBatchGroup* group = &batch->groups[g];
+        int gap = group->length - pattern->length;
+        if (gap > cutoff || -gap > cutoff
+            || filter(batch, group, pattern, cutoff, *ties, padding) == 0)
+        {
+            continue;
+        }
+
+        if (batch->kernel == EDIT_BATCH_SCALAR || cutoff >= UINT8_MAX)
+        {
+            for (int lane = 0; lane < group->count; lane++)
+            {
+                int word = group->first + lane;
+                int within = cutoff - (batch->index[word] > *ties);
+                if (padding[lane])
+                {
+                    continue;
+                }
+                int distance = editDistancePattern(engine, pattern,
+                                                   batch->words[word],
+                                                   group->length, within);
+                if (distance <= within)
+                {
+                    cutoff = visitor(batch->index[word], distance, context);
+                }
+            }
+            continue;
+        }
+
+#ifdef EDIT_BATCH_X86
+        // lanes the filter left out are measured as padding, which lets
+        // the kernel stop sooner
+        const uint8_t* characters = batch->characters + group->offset;
+        if (batch->kernel == EDIT_BATCH_AVX2)
+        {
+            editBatchGroupAvx2(characters, group->length, padding,
+                               pattern->string, pattern->length, cutoff,
+                               engine->lanes, distances);
+        }
+        else
+        {
+            for (int half = 0; half < EDIT_BATCH_LANES; half += 16)
+            {
+                editBatchGroupSse2(characters + half, group->length,
+                                   padding + half, pattern->string,
+                                   pattern->length, cutoff, engine->lanes,
+                                   distances + half);
+            }
+        }
+#endif
+        for (int lane = 0; lane < group->count; lane++)
+        {
+            int word = group->first + lane;
+            if (distances[lane] <= cutoff - (batch->index[word] > *ties))
+            {
+                cutoff = visitor(batch->index[word], distances[lane],
+                                 context);
+            }
+        }
+    }
+    return cutoff;
+}
+
+/**
+ * Same as editDistanceBatchScan, but visits the lengths nearest the
+ * pattern's first: its own, then one shorter, one longer, two shorter
+ * and so on. A query whose visitor tightens the cutoff finds close words
+ * early, and the scan ends as soon as the lengths left on both sides are
+ * further from the pattern's than the cutoff. Words are reported length
+ * by length in that order rather than in batch order.
+ * @param engine Scratch memory used by the calling thread.
+ * @param batch
+ * @param pattern The query.
+ * @param cutoff Largest distance to report.
+ * @param ties As for editDistanceBatchScan.
+ * @param visitor
+ * @param context Passed through to the visitor.
+ * @return The cutoff after the last word.
+ */
+int editDistanceBatchScanNearest(EditDistance* engine,
+                                 const EditDistanceBatch* batch,
+                                 const EditDistancePattern* pattern,
+                                 int cutoff, const int* ties,
+                                 EditBatchVisitor visitor, void* context)
+{
+    assert(batch);
+    assert(pattern);
+
+    int up = pattern->length;
+    int down = pattern->length - 1;
+    if (down > batch->maxLength)
+    {
+        down = batch->maxLength;
+    }
+    while (cutoff >= 0)
+    {
+        int upGap = up <= batch->maxLength ? up - pattern->length : INT_MAX;
+        int downGap = down >= 0 ? pattern->length - down : INT_MAX;
+        if ((upGap < downGap ? upGap : downGap) > cutoff)
+        {
+            break;
+        }
+        int length = upGap < downGap ? up++ : down--;
+        int first = batch->lengthGroups[length];
+        int last = batch->lengthGroups[length + 1];
+        if (length == pattern->length && length > 0)
+        {
+            // the groups holding words with the pattern's first character
+            uint8_t c = pattern->string[0];
+            int low = first;
+            while (low < last
+                   && (uint8_t)batch->words[batch->groups[low].first
+                                            + batch->groups[low].count
+                                            - 1][0] < c)
+            {
+                low++;
+            }
+            int high = low;
+            while (high < last
+                   && (uint8_t)batch->words[batch->groups[high].first][0]
+                      <= c)
+            {
+                high++;
+            }
+            cutoff = editDistanceBatchScanGroups(engine, batch, low, high,
+                                                 pattern, cutoff, ties,
+                                                 visitor, context);
+            cutoff = editDistanceBatchScanGroups(engine, batch, first, low,
+                                                 pattern, cutoff, ties,
+                                                 visitor, context);
+            first = high;
+        }
+        cutoff = editDistanceBatchScanGroups(engine, batch, first, last,
+                                             pattern, cutoff, ties,
+                                             visitor, context);
+    }
+    return cutoff;
+}
@@ -0,0 +1,99 @@
+#ifndef EDIT_DISTANCE_BATCH_H
+#define EDIT_DISTANCE_BATCH_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "editDistance.h"
+#include <stdint.h>
+
+// Number of words measured together; one byte lane each in the kernels.
+#define EDIT_BATCH_LANES 32
+
+typedef struct EditDistanceBatch EditDistanceBatch;
+typedef struct EditBatchGroup EditBatchGroup;
+
+typedef enum
+{
+    // One word at a time with editDistancePattern.
+    EDIT_BATCH_SCALAR,
+    // Sixteen words per instruction.
+    EDIT_BATCH_SSE2,
+    // Thirty-two words per instruction.
+    EDIT_BATCH_AVX2
+} EditBatchKernel;
+
+// Called by editDistanceBatchScan for each word within the cutoff with the
+// word's index in the list the batch was built from. Returns the cutoff to
+// use for the rest of the scan.
+typedef int (*EditBatchVisitor)(int index, int distance, void* context);
+
+/*
+ * Up to EDIT_BATCH_LANES words of the same length, stored transposed: byte
+ * lane of row i holds character i of the lane's word.
+ */
+struct EditBatchGroup
+{
+    int length;
+    // Number of lanes holding words; the rest are padding.
+    int count;
+    // Batch index of the word in lane 0; the others follow in order.
+    int first;
+    // Offset of row 0 in the batch's characters.
+    size_t offset;
+};
+
+/*
+ * A word list laid out for measuring one query against many words at
+ * once. Words are sorted by length, then by first character, into
+ * groups, so a whole group can be skipped when its length is too far from
+ * the query's, and the groups of each length can be found directly.
+ */
+struct EditDistanceBatch
+{
+    // Index in the original list of each word, in batch order.
+    int* index;
+    // Each word and its length, in batch order.
+    const char** words;
+    int* lengths;
+    // Characters of each word as editDistanceCharacters sums them up, in
+    // batch order.
+    uint64_t* masks;
+    int size;
+    EditBatchGroup* groups;
+    int numGroups;
+    int maxLength;
+    // First group of each length from 0 to maxLength + 1; the groups of a
+    // length end where those of the next one start.
+    int* lengthGroups;
+    // Rows of every group, EDIT_BATCH_LANES bytes each.
+    uint8_t* characters;
+    EditBatchKernel kernel;
+    // 1 if the processor counts the bits of the masks in one instruction.
+    int popcnt;
+};
+
+void editDistanceBatchInit(EditDistanceBatch* batch, const char** words,
+                           const int* lengths, int size);
+void editDistanceBatchCleanUp(EditDistanceBatch* batch);
+int editDistanceBatchUseKernel(EditDistanceBatch* batch,
+                               EditBatchKernel kernel);
+int editDistanceBatchScan(EditDistance* engine,
+                          const EditDistanceBatch* batch,
+                          const EditDistancePattern* pattern, int cutoff,
+                          const int* ties, EditBatchVisitor visitor,
+                          void* context);
+int editDistanceBatchScanGroups(EditDistance* engine,
+                                const EditDistanceBatch* batch, int first,
+                                int last, const EditDistancePattern* pattern,
+                                int cutoff, const int* ties,
+                                EditBatchVisitor visitor, void* context);
+int editDistanceBatchScanNearest(EditDistance* engine,
+                                 const EditDistanceBatch* batch,
+                                 const EditDistancePattern* pattern,
+                                 int cutoff, const int* ties,
+                                 EditBatchVisitor visitor, void* context);
+
+#endif
@@ -5,16 +5,20 @@
  * Date: 2019-11-20
  */
 
+// for mmap and fileno
+#define _POSIX_C_SOURCE 200809L
+
 #include "hashMap.h"
+#include <sys/mman.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
 
-int hashFunction1(const char* key)
+uint32_t hashFunction1(const char* key)
 {
-    int r = 0;
+    uint32_t r = 0;
     for (int i = 0; key[i] != '\0'; i++)
     {
         r += key[i];
@@ -22,9 +26,9 @@ int hashFunction1(const char* key)
     return r;
 }
 
-int hashFunction2(const char* key)
+uint32_t hashFunction2(const char* key)
 {
-    int r = 0;
+    uint32_t r = 0;
     for (int i = 0; key[i] != '\0'; i++)
     {
         r += (i + 1) * key[i];
@@ -33,30 +37,442 @@ int hashFunction2(const char* key)
 }
 
 /**
- * Creates a new hash table link with a copy of the key string.
- * @param key Key string to copy in the link.
+ * 32-bit FNV-1a. Each byte is xored in and then multiplied by the FNV prime,
+ * so every character and its position affect all of the output bits.
+ * @param key
+ * @return Hash of the key.
+ */
+uint32_t hashFunctionFnv1a(const char* key)
+{
+    uint32_t r = 2166136261u;
+    for (int i = 0; key[i] != '\0'; i++)
+    {
+        r ^= (unsigned char)key[i];
+        r *= 16777619u;
+    }
+    return r;
+}
+
+/**
+ * Mixes one 4 byte block for hashFunctionMurmur3.
+ * @param block
+ * @return Scrambled block.
+ */
+static uint32_t murmurScramble(uint32_t block)
+{
+    block *= 0xcc9e2d51u;
+    block = (block << 15) | (block >> 17);
+    block *= 0x1b873593u;
+    return block;
+}
+
+/**
+ * 32-bit MurmurHash3. The key is consumed 4 bytes at a time and the length
+ * is folded into the final avalanche, so keys that differ only in length
+ * or in byte order still spread across the table.
+ * @param key
+ * @return Hash of the key.
+ */
+uint32_t hashFunctionMurmur3(const char* key)
+{
+    uint32_t r = 0x9747b28cu;
+    uint32_t block = 0;
+    int i;
+    for (i = 0; key[i] != '\0'; i++)
+    {
+        block |= (uint32_t)(unsigned char)key[i] << (8 * (i & 3));
+        if ((i & 3) == 3)
+        {
+            r ^= murmurScramble(block);
+            r = (r << 13) | (r >> 19);
+            r = r * 5 + 0xe6546b64u;
+            block = 0;
+        }
+    }
+    if (i & 3)
+    {
+        r ^= murmurScramble(block);
+    }
+    r ^= (uint32_t)i;
+    r ^= r >> 16;
+    r *= 0x85ebca6bu;
+    r ^= r >> 13;
+    r *= 0xc2b2ae35u;
+    r ^= r >> 16;
+    return r;
+}
+
+/*
+ * Hash functions that can be selected by name at runtime.
+ */
+static const struct
+{
+    const char* name;
+    HashFunction function;
+} hashFunctions[] = {
+    { "sum", hashFunction1 },
+    { "weighted", hashFunction2 },
+    { "fnv1a", hashFunctionFnv1a },
+    { "murmur3", hashFunctionMurmur3 }
+};
+
+#define NUM_HASH_FUNCTIONS ((int)(sizeof(hashFunctions) / sizeof(hashFunctions[0])))
+
+/**
+ * Looks up a hash function by name ("sum", "weighted", "fnv1a" or
+ * "murmur3").
+ * @param name
+ * @return The hash function or NULL if the name is unknown.
+ */
+HashFunction hashFunctionByName(const char* name)
+{
+    for (int i = 0; i < NUM_HASH_FUNCTIONS; i++)
+    {
+        if (strcmp(hashFunctions[i].name, name) == 0)
+        {
+            return hashFunctions[i].function;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Returns the name hashFunctionByName knows the hash function by.
+ * @param hashFunction
+ * @return The name or NULL if the function is not one of the built in ones.
+ */
+const char* hashFunctionName(HashFunction hashFunction)
+{
+    for (int i = 0; i < NUM_HASH_FUNCTIONS; i++)
+    {
+        if (hashFunctions[i].function == hashFunction)
+        {
+            return hashFunctions[i].name;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Allocates memory from the map's arena by bumping the offset into the
+ * current block, starting a new block twice the size of the last one
+ * when it is full. The memory is only released by hashMapCleanUp.
+ * @param map
+ * @param size Number of bytes needed.
+ * @param align Required alignment, a power of two.
+ * @return Pointer to the memory.
+ */
+static void* hashArenaAlloc(HashMap* map, size_t size, size_t align)
+{
+    HashArenaBlock* block = map->arena;
+    size_t offset = 0;
+    if (block != NULL)
+    {
+        offset = (block->used + align - 1) & ~(align - 1);
+    }
+    if (block == NULL || offset + size > block->size)
+    {
+        size_t blockSize = ARENA_BLOCK_SIZE;
+        if (block != NULL && block->size < ARENA_MAX_BLOCK_SIZE)
+        {
+            blockSize = block->size * 2;
+        }
+        else if (block != NULL)
+        {
+            blockSize = block->size;
+        }
+        if (blockSize < size)
+        {
+            blockSize = size;
+        }
+        block = malloc(sizeof(HashArenaBlock) + blockSize);
+        assert(block);
+        block->next = map->arena;
+        block->size = blockSize;
+        map->arena = block;
+        offset = 0;
+    }
+    block->used = offset + size;
+    return block->data + offset;
+}
+
+/**
+ * Copies the key string into the map's arena.
+ * @param map
+ * @param key
+ * @return The arena copy of the key.
+ */
+static char* hashArenaKey(HashMap* map, const char* key)
+{
+    size_t length = strlen(key) + 1;
+    char* copy = hashArenaAlloc(map, length, 1);
+    memcpy(copy, key, length);
+    return copy;
+}
+
+/**
+ * Allocates a buffer that belongs to the map and is freed along with it,
+ * for callers that build keys in place and insert them with
+ * hashMapFindOrInsertBorrowed. The buffer is kept on its own list rather
+ * than in the arena, so it never sets the size of the arena's next block.
+ * @param map
+ * @param size Number of bytes needed.
+ * @return Pointer to the buffer.
+ */
+char* hashMapKeyBuffer(HashMap* map, size_t size)
+{
+    assert(map);
+    HashArenaBlock* block = malloc(sizeof(HashArenaBlock) + size);
+    assert(block);
+    block->size = size;
+    block->used = size;
+    block->next = map->keyBuffers;
+    map->keyBuffers = block;
+    return block->data;
+}
+
+/**
+ * Creates a new hash table link for a key string the map already holds,
+ * either an arena copy or a borrowed key. Links released with
+ * hashLinkDelete are reused before new ones are carved from the map's
+ * arena.
+ * @param map Map that will own the link.
+ * @param key Key string to store in the link.
+ * @param hash The key's hash, kept so resizing never recomputes it.
  * @param value Value to set in the link.
  * @param next Pointer to set as the link's next.
- * @return Hash table link allocated on the heap.
+ * @return Hash table link allocated in the map's arena.
  */
-HashLink* hashLinkNew(const char* key, int value, HashLink* next)
+HashLink* hashLinkNew(HashMap* map, char* key, uint32_t hash, int value,
+                      HashLink* next)
 {
-    HashLink* link = malloc(sizeof(HashLink));
-    link->key = malloc(sizeof(char) * (strlen(key) + 1));
-    strcpy(link->key, key);
+    HashLink* link = map->freeLinks;
+    if (link != NULL)
+    {
+        map->freeLinks = link->next;
+    }
+    else
+    {
+        link = hashArenaAlloc(map, sizeof(HashLink), sizeof(void*));
+    }
+    link->key = key;
+    link->hash = hash;
     link->value = value;
     link->next = next;
     return link;
 }
 
 /**
- * Free the allocated memory for a hash table link created with hashLinkNew.
+ * Returns a link created with hashLinkNew to the map's free list. Its key
+ * bytes stay in the arena until the map is cleaned up.
+ * @param map
  * @param link
  */
-static void hashLinkDelete(HashLink* link)
+static void hashLinkDelete(HashMap* map, HashLink* link)
+{
+    link->key = NULL;
+    link->next = map->freeLinks;
+    map->freeLinks = link;
+}
+
+/**
+ * @param map
+ * @param entry Index of one of an open addressing map's entries.
+ * @return The entry's key, from the saved keys while the map is still
+ *         read from its file.
+ */
+static const char* hashEntryKey(const HashMap* map, int entry)
+{
+    if (map->fileEntries != NULL)
+    {
+        return map->fileKeys + map->fileEntries[entry].key;
+    }
+    return map->entries[entry].key;
+}
+
+/**
+ * @param map
+ * @param entry Index of one of an open addressing map's entries.
+ * @return Pointer to the entry's value, which is read only while the map
+ *         is still read from its file.
+ */
+static int* hashEntryValue(HashMap* map, int entry)
 {
-    free(link->key);
-    free(link);
+    if (map->fileEntries != NULL)
+    {
+        return (int*)&map->fileEntries[entry].value;
+    }
+    return &map->entries[entry].value;
+}
+
+/**
+ * Walks the key's bucket in a chained map that is still read from its
+ * file, following the saved link indexes.
+ * @param map
+ * @param key
+ * @param hash The key's hash.
+ * @return The saved link holding the key, or NULL if there is none.
+ */
+static const HashFileEntry* hashFileLinkFind(const HashMap* map,
+                                             const char* key, uint32_t hash)
+{
+    uint32_t next = map->fileTable[hash % (uint32_t)map->capacity];
+    while (next != 0)
+    {
+        const HashFileEntry* link = &map->fileEntries[next - 1];
+        if (link->hash == hash && strcmp(map->fileKeys + link->key, key) == 0)
+        {
+            return link;
+        }
+        next = link->next;
+    }
+    return NULL;
+}
+
+/**
+ * Returns the index of the slot holding the key in an open addressing map,
+ * or of the empty slot that ends the key's probe sequence if the key is not
+ * in the table. Slots whose stored hash differs are skipped without
+ * looking at their entry.
+ * @param map
+ * @param key
+ * @param hash The key's hash.
+ * @return Slot index.
+ */
+static int hashSlotFind(HashMap* map, const char* key, uint32_t hash)
+{
+    uint32_t mask = map->capacity - 1;
+    uint32_t index = hash & mask;
+    HashSlot* slot = &map->slots[index];
+    while (slot->entry != HASH_SLOT_EMPTY)
+    {
+        if (slot->hash == hash
+            && strcmp(hashEntryKey(map, slot->entry), key) == 0)
+        {
+            return index;
+        }
+        index = (index + 1) & mask;
+        slot = &map->slots[index];
+    }
+    return index;
+}
+
+/**
+ * Points the first empty slot of the hash's probe sequence at the entry.
+ * The entry's key must not already have a slot.
+ * @param map
+ * @param hash
+ * @param entry Index of the entry.
+ */
+static void hashSlotPlace(HashMap* map, uint32_t hash, int entry)
+{
+    uint32_t mask = map->capacity - 1;
+    uint32_t index = hash & mask;
+    while (map->slots[index].entry != HASH_SLOT_EMPTY)
+    {
+        index = (index + 1) & mask;
+    }
+    map->slots[index].hash = hash;
+    map->slots[index].entry = entry;
+}
+
+/**
+ * @param map
+ * @param array
+ * @return 1 if the array is part of the file the map was loaded from,
+ *         which is only released with the map, 0 otherwise.
+ */
+static int hashMapInImage(HashMap* map, const void* array)
+{
+    const char* bytes = array;
+    return map->image != NULL && bytes >= map->image
+           && bytes < map->image + map->imageBytes;
+}
+
+/**
+ * Frees one of the map's arrays unless it is part of a loaded file.
+ * @param map
+ * @param array
+ */
+static void hashMapFreeArray(HashMap* map, void* array)
+{
+    if (!hashMapInImage(map, array))
+    {
+        free(array);
+    }
+}
+
+/**
+ * Makes room in an open addressing map's entry array for at least the
+ * given number of entries.
+ * @param map
+ * @param count
+ */
+static void hashEntryReserve(HashMap* map, int count)
+{
+    if (count <= map->entryCapacity)
+    {
+        return;
+    }
+    int capacity = map->entryCapacity > 0 ? map->entryCapacity : 8;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+    map->entries = realloc(map->entries, sizeof(HashEntry) * capacity);
+    assert(map->entries);
+    map->entryCapacity = capacity;
+}
+
+/**
+ * Copies a map that is still read from its file into memory of its own
+ * before it is first changed: the slots and entries, or the bucket table
+ * and links, each chain in the same order. The keys stay in the file and
+ * are borrowed from it. Does nothing for any other map.
+ * @param map
+ */
+static void hashMapThaw(HashMap* map)
+{
+    const HashFileEntry* saved = map->fileEntries;
+    if (saved == NULL)
+    {
+        return;
+    }
+    map->fileEntries = NULL;
+    if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        HashSlot* slots = malloc(sizeof(HashSlot) * map->capacity);
+        assert(slots);
+        memcpy(slots, map->slots, sizeof(HashSlot) * map->capacity);
+        map->slots = slots;
+        hashEntryReserve(map, map->size);
+        for (int i = 0; i < map->size; i++)
+        {
+            map->entries[i].key = (char*)map->fileKeys + saved[i].key;
+            map->entries[i].hash = saved[i].hash;
+            map->entries[i].value = saved[i].value;
+        }
+    }
+    else
+    {
+        map->table = malloc(sizeof(HashLink*) * map->capacity);
+        assert(map->table);
+        for (int i = 0; i < map->capacity; i++)
+        {
+            HashLink** tail = &map->table[i];
+            for (uint32_t next = map->fileTable[i]; next != 0;
+                 next = saved[next - 1].next)
+            {
+                const HashFileEntry* link = &saved[next - 1];
+                *tail = hashLinkNew(map, (char*)map->fileKeys + link->key,
+                                    link->hash, link->value, NULL);
+                tail = &(*tail)->next;
+            }
+            *tail = NULL;
+        }
+    }
+    map->fileTable = NULL;
+    map->fileKeys = NULL;
 }
 
 /**
@@ -69,7 +485,26 @@ void hashMapInit(HashMap* map, int capacity)
 {
     map->capacity = capacity;
     map->size = 0;
+    map->table = NULL;
+    map->slots = NULL;
+    if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        // A power of two capacity lets probe sequences wrap with a mask.
+        map->capacity = 1;
+        while (map->capacity < capacity)
+        {
+            map->capacity *= 2;
+        }
+        map->slots = malloc(sizeof(HashSlot) * map->capacity);
+        assert(map->slots);
+        for (int i = 0; i < map->capacity; i++)
+        {
+            map->slots[i].entry = HASH_SLOT_EMPTY;
+        }
+        return;
+    }
     map->table = malloc(sizeof(HashLink*) * capacity);
+    assert(map->table);
     for (int i = 0; i < capacity; i++)
     {
         map->table[i] = NULL;
@@ -77,33 +512,49 @@ void hashMapInit(HashMap* map, int capacity)
 }
 
 /**
- * Removes all links in the map and frees all allocated memory. You can use
- * hashLinkDelete to free the links.
+ * Removes all links in the map and frees all allocated memory. Links and
+ * keys all live in the map's arena, so they are released a block at a time
+ * instead of one by one.
  * @param map
  */
 void hashMapCleanUp(HashMap* map)
 {
     // FIXME: implement
 	assert(map);
-	assert(map->table);
-	int buckets = map->capacity;
-	int i;
-	struct HashLink *previousLink = NULL;
-	struct HashLink *currentLink = NULL;
-	/*
-	 * Iterate through each bucket. if the bucket is not null, proceed down
-	 * the chain deleting each element before freeing the table
-	 */
-	for (i = 0; i < buckets; ++i){
-		currentLink = map->table[i];
-		while (currentLink) {
-			previousLink = currentLink;
-			currentLink = currentLink->next;
-			hashLinkDelete(previousLink);
-			previousLink = NULL;
+	struct HashArenaBlock *lists[] = { map->arena, map->keyBuffers };
+	struct HashArenaBlock *nextBlock = NULL;
+	
+	for (int i = 0; i < 2; ++i) {
+		struct HashArenaBlock *block = lists[i];
+		while (block) {
+			nextBlock = block->next;
+			free(block);
+			block = nextBlock;
 		}
 	}
-	free(map->table);
+	map->arena = NULL;
+	map->keyBuffers = NULL;
+	map->freeLinks = NULL;
+	
+	// the table and entries only hold pointers into the arena
+	hashMapFreeArray(map, map->table);
+	hashMapFreeArray(map, map->slots);
+	hashMapFreeArray(map, map->entries);
+	map->table = NULL;
+	map->slots = NULL;
+	map->entries = NULL;
+	map->entryCapacity = 0;
+	map->fileEntries = NULL;
+	map->fileTable = NULL;
+	map->fileKeys = NULL;
+	if (map->imageMapped) {
+		munmap(map->image, map->imageBytes);
+	}
+	else {
+		free(map->image);
+	}
+	map->image = NULL;
+	map->imageBytes = 0;
 }
 
 /**
@@ -114,7 +565,34 @@ void hashMapCleanUp(HashMap* map)
  */
 HashMap* hashMapNew(int capacity)
 {
+    return hashMapNewBackend(capacity, HASH_MAP_CHAINED);
+}
+
+/**
+ * Creates a hash table map with the given storage backend. Open addressing
+ * maps round the capacity up to a power of two.
+ * @param capacity The number of buckets or slots.
+ * @param backend
+ * @return The allocated map.
+ */
+HashMap* hashMapNewBackend(int capacity, HashMapBackend backend)
+{
+    assert(capacity > 0);
     HashMap* map = malloc(sizeof(HashMap));
+    assert(map);
+    map->backend = backend;
+    map->hashFunction = HASH_FUNCTION;
+    map->arena = NULL;
+    map->keyBuffers = NULL;
+    map->freeLinks = NULL;
+    map->entries = NULL;
+    map->entryCapacity = 0;
+    map->fileEntries = NULL;
+    map->fileTable = NULL;
+    map->fileKeys = NULL;
+    map->image = NULL;
+    map->imageBytes = 0;
+    map->imageMapped = 0;
     hashMapInit(map, capacity);
     return map;
 }
@@ -134,7 +612,7 @@ void hashMapDelete(HashMap* map)
  * Returns a pointer to the value of the link with the given key  and skip traversing as well. Returns NULL
  * if no link with that key is in the table.
  * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
+ * Use the map's hash function and capacity to find the index of the
  * correct linked list bucket. Also make sure to search the entire list.
  * 
  * @param map
@@ -145,18 +623,27 @@ int* hashMapGet(HashMap* map, const char* key)
 {
     // FIXME: implement
 	assert(map);
-	assert(map->table);
 	int hashIndex;
+	uint32_t hash;
 	struct HashLink *currentLink = NULL;
 	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		hashIndex = hashSlotFind(map, key, map->hashFunction(key));
+		if (map->slots[hashIndex].entry != HASH_SLOT_EMPTY) {
+			return hashEntryValue(map, map->slots[hashIndex].entry);
+		}
+		return NULL;
+	}
+	
 	/*
 	 * Enter the hash table at the hash associated with key
 	 */
-	hashIndex = HASH_FUNCTION(key);
-	hashIndex %= map->capacity;
-	if (hashIndex < 0) {
-		hashIndex += map->capacity;
+	hash = map->hashFunction(key);
+	if (map->fileEntries) {
+		const HashFileEntry *link = hashFileLinkFind(map, key, hash);
+		return link ? (int *)&(link->value) : NULL;
 	}
+	hashIndex = hash % (uint32_t)map->capacity;
 	
 	currentLink = map->table[hashIndex];
 	
@@ -165,7 +652,7 @@ int* hashMapGet(HashMap* map, const char* key)
 	 * bucket ends or the key is found. return a pointer to the value if found
 	 */
 	while (currentLink) {
-		if (!strcmp(currentLink->key, key)) {
+		if (currentLink->hash == hash && !strcmp(currentLink->key, key)) {
 			return &(currentLink->value);
 		}
 		currentLink = currentLink->next;
@@ -177,10 +664,8 @@ int* hashMapGet(HashMap* map, const char* key)
 /**
  * Resizes the hash table to have a number of buckets equal to the given 
  * capacity (double of the old capacity). After allocating the new table, 
- * all of the links need to rehashed into it because the capacity has changed.
- * 
- * Remember to free the old table and any old links if you use hashMapPut to
- * rehash them.
+ * the existing links (or slots) are moved into it by their cached hash;
+ * no link is allocated or copied and no key is hashed again.
  * 
  * @param map
  * @param capacity The new number of buckets.
@@ -189,41 +674,208 @@ void resizeTable(HashMap* map, int capacity)
 {
     // FIXME: implement
 	assert(map);
+	hashMapThaw(map);
+	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		// the entries stay put; only new slots are pointed at them
+		int size = map->size;
+		free(map->slots);
+		hashMapInit(map, capacity);
+		map->size = size;
+		for (int i = 0; i < size; ++i) {
+			hashSlotPlace(map, map->entries[i].hash, i);
+		}
+		return;
+	}
 	assert(map->table);
 	
-	//move existing table into a new map
-	struct HashMap *oldMap = malloc(sizeof(struct HashMap));
-	oldMap->size = map->size;
-	oldMap->capacity = map->capacity;
-	oldMap->table = map->table;
-	map->table = NULL;
+	//keep hold of the existing table
+	struct HashLink **oldTable = map->table;
+	int oldCapacity = map->capacity;
+	int size = map->size;
 	
 	// resize the incoming map to the selected size
 	hashMapInit(map, capacity);
 	
 	struct HashLink *currentLink = NULL;
+	struct HashLink *nextLink = NULL;
+	int index;
 	
-	//copy each key-value pair from the old map to the new map
-	for (int i = 0; i < oldMap->capacity; ++i) {
-		currentLink = oldMap->table[i];
+	/*
+	 * move each link from the old table onto the front of its new bucket,
+	 * using the hash cached in the link. nothing is allocated or copied
+	 */
+	for (int i = 0; i < oldCapacity; ++i) {
+		currentLink = oldTable[i];
 		while (currentLink) {
-			hashMapPut(map, currentLink->key, currentLink->value);
-			currentLink = currentLink->next;
+			nextLink = currentLink->next;
+			index = currentLink->hash % (uint32_t)map->capacity;
+			currentLink->next = map->table[index];
+			map->table[index] = currentLink;
+			currentLink = nextLink;
 		}
 	}
+	map->size = size;
 	
-	hashMapDelete(oldMap);
+	free(oldTable);
 	
 }
 
 /**
- * Updates the given key-value pair in the hash table. If a link with the given
- * key already exists, this will just update the value and skip traversing. Otherwise, it will
- * create a new link with the given key and value and add it to the table
- * bucket's linked list. You can use hashLinkNew to create the link.
+ * Grows the table so that it can hold the given number of links without
+ * resizing again. Does nothing if it is already big enough.
+ * @param map
+ * @param size The number of links the table should be able to hold.
+ */
+void hashMapReserve(HashMap* map, int size)
+{
+	assert(map);
+	int capacity;
+	
+	hashMapThaw(map);
+	// enough room that the load stays under the maximum with size links
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		capacity = (int)(size / MAX_SLOT_LOAD) + 1;
+		hashEntryReserve(map, size);
+	}
+	else {
+		capacity = (int)(size / MAX_TABLE_LOAD) + 1;
+	}
+	if (capacity > map->capacity) {
+		resizeTable(map, capacity);
+	}
+}
+
+/**
+ * Switches the map to a different hash function and rehashes any links
+ * already in the table.
+ * @param map
+ * @param hashFunction
+ */
+void hashMapSetHashFunction(HashMap* map, HashFunction hashFunction)
+{
+	assert(map);
+	assert(hashFunction);
+	if (map->hashFunction == hashFunction) {
+		return;
+	}
+	hashMapThaw(map);
+	map->hashFunction = hashFunction;
+	// refresh the cached hashes so the resize places entries by the new one
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		for (int i = 0; i < map->size; ++i) {
+			map->entries[i].hash = hashFunction(map->entries[i].key);
+		}
+	}
+	else {
+		for (int i = 0; i < map->capacity; ++i) {
+			for (HashLink *link = map->table[i]; link; link = link->next) {
+				link->hash = hashFunction(link->key);
+			}
+		}
+	}
+	if (map->size > 0) {
+		resizeTable(map, map->capacity);
+	}
+}
+
+/**
+ * Returns a pointer to the value of the link with the given key, first
+ * adding a link with the given value if the key is not in the table. The
+ * key is hashed once and its bucket (or probe sequence) walked once; if the
+ * table has to grow, the new bucket comes from the same hash.
+ * @param map
+ * @param key
+ * @param value Value for the link if one has to be added.
+ * @param copyKey 1 to store an arena copy of a new key, 0 to store the
+ *        caller's pointer.
+ * @return Pointer to the link's value.
+ */
+static int* hashMapInsertKey(HashMap* map, const char* key, int value,
+                             int copyKey)
+{
+	assert(map);
+	
+	uint32_t hash = map->hashFunction(key);
+	int index;
+	
+	hashMapThaw(map);
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		index = hashSlotFind(map, key, hash);
+		if (map->slots[index].entry != HASH_SLOT_EMPTY) {
+			return &(map->entries[map->slots[index].entry].value);
+		}
+		if (map->size + 1 > map->capacity * MAX_SLOT_LOAD) {
+			resizeTable(map, map->capacity * 2);
+			index = hashSlotFind(map, key, hash);
+		}
+		hashEntryReserve(map, map->size + 1);
+		HashEntry *entry = &(map->entries[map->size]);
+		entry->key = copyKey ? hashArenaKey(map, key) : (char *)key;
+		entry->hash = hash;
+		entry->value = value;
+		map->slots[index].hash = hash;
+		map->slots[index].entry = map->size;
+		++(map->size);
+		return &(entry->value);
+	}
+	assert(map->table);
+	
+	index = hash % (uint32_t)map->capacity;
+	for (HashLink *link = map->table[index]; link; link = link->next) {
+		if (link->hash == hash && strcmp(link->key, key) == 0) {
+			return &(link->value);
+		}
+	}
+	
+	if (hashMapTableLoad(map) >= MAX_TABLE_LOAD) {
+		resizeTable(map, map->capacity * 2);
+		index = hash % (uint32_t)map->capacity;
+	}
+	map->table[index] = hashLinkNew(map,
+		copyKey ? hashArenaKey(map, key) : (char *)key, hash, value,
+		map->table[index]);
+	++(map->size);
+	return &(map->table[index]->value);
+}
+
+/**
+ * Returns a pointer to the value of the link with the given key, first
+ * adding a link with a copy of the key and the given value if the key is
+ * not in the table. The key is hashed once and its bucket (or probe
+ * sequence) walked once.
+ * 
+ * The pointer is only valid until the map is next modified.
  * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
- * correct linked list bucket.
+ * @param map
+ * @param key
+ * @param value Value for the link if one has to be added.
+ * @return Pointer to the link's value.
+ */
+int* hashMapFindOrInsert(HashMap* map, const char* key, int value)
+{
+	return hashMapInsertKey(map, key, value, 1);
+}
+
+/**
+ * Same as hashMapFindOrInsert, except that a new link keeps the key
+ * pointer itself instead of copying the string. The key must stay valid
+ * and unchanged for as long as the map exists, for example by living in a
+ * buffer from hashMapKeyBuffer.
+ * @param map
+ * @param key
+ * @param value Value for the link if one has to be added.
+ * @return Pointer to the link's value.
+ */
+int* hashMapFindOrInsertBorrowed(HashMap* map, const char* key, int value)
+{
+	return hashMapInsertKey(map, key, value, 0);
+}
+
+/**
+ * Updates the given key-value pair in the hash table. If a link with the given
+ * key already exists, this will just update the value. Otherwise, it will
+ * create a new link with the given key and value and add it to the table.
  * 
  * @param map
  * @param key
@@ -231,35 +883,59 @@ void resizeTable(HashMap* map, int capacity)
  */
 void hashMapPut(HashMap* map, const char* key, int value)
 {
-    // FIXME: implement
-	assert(map);
-	assert(map->table);
+	*(hashMapFindOrInsert(map, key, value)) = value;
+}
+
+/**
+ * Removes the key from an open addressing map. Instead of leaving a
+ * tombstone, later slots of the probe run are shifted back into the hole
+ * whenever that keeps them reachable from their home slot. The last entry
+ * then moves into the removed one's place to keep the entries dense.
+ * @param map
+ * @param key
+ */
+static void hashSlotRemove(HashMap* map, const char* key)
+{
+	uint32_t mask = map->capacity - 1;
+	uint32_t hole = hashSlotFind(map, key, map->hashFunction(key));
+	uint32_t next = hole;
+	uint32_t home;
+	int removed = map->slots[hole].entry;
+	int last = map->size - 1;
 	
-	struct HashLink *newLink = NULL;
-	int index;
+	if (removed == HASH_SLOT_EMPTY) {
+		return;
+	}
 	
-	if (hashMapContainsKey(map, key)) {
-		*(hashMapGet(map, key)) = value;
+	while (1) {
+		next = (next + 1) & mask;
+		if (map->slots[next].entry == HASH_SLOT_EMPTY) {
+			break;
+		}
+		// move the slot back if the hole is no further from its home
+		home = map->slots[next].hash & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			map->slots[hole] = map->slots[next];
+			hole = next;
+		}
 	}
-	else {
-		if (hashMapTableLoad(map) >= MAX_TABLE_LOAD) {
-			resizeTable(map, map->capacity * 2);
+	map->slots[hole].entry = HASH_SLOT_EMPTY;
+	
+	if (removed != last) {
+		map->entries[removed] = map->entries[last];
+		next = map->entries[removed].hash & mask;
+		while (map->slots[next].entry != last) {
+			next = (next + 1) & mask;
 		}
-		
-		index = HASH_FUNCTION(key);
-		index %= map->capacity;
-		if (index < 0) index += map->capacity;
-		
-		newLink = hashLinkNew(key, value, map->table[index]);
-		map->table[index] = newLink;
-		++(map->size);
+		map->slots[next].entry = removed;
 	}
+	--(map->size);
 }
 
 /**
  * Removes and frees the link with the given key from the table. If no such link
  * exists, this does nothing. Remember to search the entire linked list at the
- * bucket. You can use hashLinkDelete to free the link.
+ * bucket. The link goes back on the map's free list for reuse.
  * @param map
  * @param key
  */
@@ -267,12 +943,17 @@ void hashMapRemove(HashMap* map, const char* key)
 {
     // FIXME: implement
 	assert(map);
+	hashMapThaw(map);
+	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		hashSlotRemove(map, key);
+		return;
+	}
 	assert(map->table);
 	
 	//select the bucket
-	int index = HASH_FUNCTION(key);
-	index %= map->capacity;
-	if (index < 0) index += map->capacity;
+	uint32_t hash = map->hashFunction(key);
+	int index = hash % (uint32_t)map->capacity;
 	
 	struct HashLink *currentLink;
 	struct HashLink *previousLink;
@@ -282,14 +963,14 @@ void hashMapRemove(HashMap* map, const char* key)
 	
 	//traverse the chain at the bucket and delete the given link if it exists
 	while (currentLink) {
-		if(!strcmp(key, currentLink->key)) {
+		if(currentLink->hash == hash && !strcmp(key, currentLink->key)) {
 			if(!previousLink) {
 				map->table[index] = currentLink->next;
 			}
 			else {
 				previousLink->next = currentLink->next;
 			}
-			hashLinkDelete(currentLink);
+			hashLinkDelete(map, currentLink);
 			currentLink = NULL;
 			--(map->size);
 			return;
@@ -302,7 +983,7 @@ void hashMapRemove(HashMap* map, const char* key)
 /**
  * Returns 1 if a link with the given key is in the table and 0 otherwise.
  * 
- * Use HASH_FUNCTION(key) and the map's capacity to find the index of the
+ * Use the map's hash function and capacity to find the index of the
  * correct linked list bucket. Also make sure to search the entire list.
  * 
  * @param map
@@ -313,19 +994,27 @@ int hashMapContainsKey(HashMap* map, const char* key)
 {
     // FIXME: implement
 	assert(map);
-	assert(map->table);
+	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		int slot = hashSlotFind(map, key, map->hashFunction(key));
+		return map->slots[slot].entry != HASH_SLOT_EMPTY;
+	}
 	
 	// select the correct bucket
-	int index = HASH_FUNCTION(key);
-	index %= map->capacity;
-	if (index < 0) index += map->capacity;
+	uint32_t hash = map->hashFunction(key);
+	int index = hash % (uint32_t)map->capacity;
+	
+	if (map->fileEntries) {
+		return hashFileLinkFind(map, key, hash) != NULL;
+	}
+	assert(map->table);
 	
 	struct HashLink *currentLink;
 	currentLink = map->table[index];
 	
 	// traverse the chain at bucket searching for the given key
 	while (currentLink) {
-		if (!strcmp(key, currentLink->key)) {
+		if (currentLink->hash == hash && !strcmp(key, currentLink->key)) {
 			return 1;
 		}
 		currentLink = currentLink->next;
@@ -359,7 +1048,7 @@ int hashMapCapacity(HashMap* map)
 }
 
 /**
- * Returns the number of table buckets without any links.
+ * Returns the number of table buckets (or slots) without any links.
  * @param map
  * @return Number of empty buckets.
  */
@@ -367,12 +1056,20 @@ int hashMapEmptyBuckets(HashMap* map)
 {
     // FIXME: implement
 	assert(map);
-	assert(map->table);
 	
 	int empties = 0;
 	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		for (int i = 0; i < map->capacity; ++i) {
+			if (map->slots[i].entry == HASH_SLOT_EMPTY) {
+				++empties;
+			}
+		}
+		return empties;
+	}
+	
 	for (int i = 0; i < map->capacity; ++i) {
-		if (!(map->table[i])) {
+		if (map->fileEntries ? !(map->fileTable[i]) : !(map->table[i])) {
 			++empties;
 		}
 	}
@@ -404,11 +1101,35 @@ void hashMapPrint(HashMap* map)
 {
   // FIXME: implement
 	assert(map);
-	assert(map->table);
 	
 	int i;
 	struct HashLink *currentLink;
 	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		for (i = 0; i < map->capacity; ++i) {
+			if (map->slots[i].entry != HASH_SLOT_EMPTY) {
+				printf("(%s, %d) ", hashEntryKey(map, map->slots[i].entry),
+					   *hashEntryValue(map, map->slots[i].entry));
+			}
+		}
+		printf("\n");
+		return;
+	}
+	if (map->fileEntries) {
+		for (i = 0; i < map->capacity; ++i) {
+			for (uint32_t next = map->fileTable[i]; next;
+				 next = map->fileEntries[next - 1].next) {
+				const HashFileEntry *link = &(map->fileEntries[next - 1]);
+				printf("(%s, %d) ", map->fileKeys + link->key, link->value);
+				if (!link->next) {
+					printf("\n");
+				}
+			}
+		}
+		return;
+	}
+	assert(map->table);
+	
 	for (i = 0; i < map->capacity; ++i) {
 		currentLink = map->table[i];
 		while (currentLink) {
@@ -422,3 +1143,589 @@ void hashMapPrint(HashMap* map)
 	
    
 }
+
+/**
+ * Points the iterator at the first link of the first filled bucket at or
+ * after the given one, or at nothing if there is none.
+ * @param itr
+ * @param bucket
+ */
+static void hashMapItrSeek(HashMapIterator* itr, int bucket)
+{
+	HashMap *map = itr->map;
+	
+	itr->nextLink = NULL;
+	while (bucket < map->capacity && !(map->table[bucket])) {
+		++bucket;
+	}
+	if (bucket < map->capacity) {
+		itr->nextLink = map->table[bucket];
+	}
+	itr->nextIndex = bucket;
+}
+
+/**
+ * Sets up the iterator to walk the map from its first entry.
+ * @param map
+ * @param itr
+ */
+void hashMapItrInit(HashMap* map, HashMapIterator* itr)
+{
+	assert(map);
+	assert(itr);
+	itr->map = map;
+	itr->nextLink = NULL;
+	itr->nextIndex = 0;
+	if (map->backend == HASH_MAP_CHAINED && !(map->fileEntries)) {
+		hashMapItrSeek(itr, 0);
+	}
+}
+
+/**
+ * Determines whether the iterator has entries left. The iterator always
+ * knows its next entry ahead of time, so this does no searching.
+ * @param itr
+ * @return 1 if hashMapItrNext can be called, 0 at the end of the map.
+ */
+int hashMapItrHasNext(HashMapIterator* itr)
+{
+	assert(itr);
+	assert(itr->map);
+	
+	if (itr->map->backend == HASH_MAP_OPEN_ADDRESSING
+		|| itr->map->fileEntries) {
+		return itr->nextIndex < itr->map->size;
+	}
+	return itr->nextLink != NULL;
+}
+
+/**
+ * Moves the iterator to the next entry and hands back pointers to its key
+ * and value inside the map. Nothing is allocated or copied; the value can
+ * be changed through the pointer. Must only be called after
+ * hashMapItrHasNext returned 1. A whole walk visits each bucket once.
+ * @param itr
+ * @param key Set to the entry's key.
+ * @param value Set to point at the entry's value.
+ */
+void hashMapItrNext(HashMapIterator* itr, const char** key, int** value)
+{
+	assert(itr);
+	assert(hashMapItrHasNext(itr));
+	HashMap *map = itr->map;
+	
+	if (map->fileEntries) {
+		// saved entries and links alike lie back to back in the file
+		const HashFileEntry *entry = &(map->fileEntries[itr->nextIndex]);
+		++(itr->nextIndex);
+		*key = map->fileKeys + entry->key;
+		*value = (int *)&(entry->value);
+		return;
+	}
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		// the entries are dense, so the next one is simply the following index
+		HashEntry *entry = &(map->entries[itr->nextIndex]);
+		++(itr->nextIndex);
+		*key = entry->key;
+		*value = &(entry->value);
+		return;
+	}
+	
+	// hand out the link found last time, then find the one after it
+	HashLink *link = itr->nextLink;
+	*key = link->key;
+	*value = &(link->value);
+	if (link->next) {
+		itr->nextLink = link->next;
+	}
+	else {
+		hashMapItrSeek(itr, itr->nextIndex + 1);
+	}
+}
+
+/**
+ * Calls the visitor once for every entry in the map, in iteration order,
+ * with the key and a pointer to the value in place. This is the cheapest
+ * way to scan the whole map. The visitor may change values but must not
+ * add or remove entries.
+ * @param map
+ * @param visitor
+ * @param context Passed through to every call of the visitor.
+ */
+void hashMapForEach(HashMap* map, HashMapVisitor visitor, void* context)
+{
+	assert(map);
+	assert(visitor);
+	
+	if (map->fileEntries) {
+		const HashFileEntry *entries = map->fileEntries;
+		for (int i = 0; i < map->size; ++i) {
+			visitor(map->fileKeys + entries[i].key, (int *)&(entries[i].value),
+					context);
+		}
+		return;
+	}
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		// a straight sweep over the entries, no empty slots to skip
+		HashEntry *entries = map->entries;
+		for (int i = 0; i < map->size; ++i) {
+			visitor(entries[i].key, &(entries[i].value), context);
+		}
+		return;
+	}
+	for (int i = 0; i < map->capacity; ++i) {
+		for (HashLink *link = map->table[i]; link; link = link->next) {
+			visitor(link->key, &(link->value), context);
+		}
+	}
+}
+
+/*
+ * Header of a file written by hashMapSave. It is followed by the map's
+ * arrays: for open addressing the slots and then the entries, for
+ * chaining the bucket table and then the links, each bucket's chain back
+ * to back in order. Then come the keys, null terminated. Entries and
+ * links are saved as HashFileEntry, with a key as its offset in the keys
+ * and a link as its index plus one; a bucket is saved as the index plus
+ * one of its first link, 0 if it is empty. Everything is in host byte
+ * order, so a file from a machine with the other byte order fails the
+ * magic number check.
+ */
+struct HashMapFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t backend;
+    // Index of the map's hash function in hashFunctions.
+    uint32_t hashFunction;
+    uint32_t capacity;
+    uint32_t size;
+    // Number of key bytes after the arrays.
+    uint32_t keyBytes;
+    // Checksum of everything after the header, checked by hashMapVerify.
+    uint32_t checksum;
+    // Checksum of the fields above, checked before anything else is.
+    uint32_t headerChecksum;
+};
+
+/**
+ * Folds the bytes into a running checksum eight at a time, each word xored
+ * in and then multiplied by the 64-bit FNV prime, so that checking a
+ * whole saved dictionary takes a fraction of a millisecond.
+ * @param checksum Checksum so far.
+ * @param bytes
+ * @param length
+ * @return Updated checksum.
+ */
+static uint32_t hashMapChecksum(uint32_t checksum, const void* bytes,
+                                size_t length)
+{
+    const unsigned char* data = bytes;
+    uint64_t sum = checksum;
+    uint64_t word;
+    size_t i = 0;
+    for (; i + sizeof(word) <= length; i += sizeof(word))
+    {
+        memcpy(&word, data + i, sizeof(word));
+        sum = (sum ^ word) * 1099511628211u;
+    }
+    for (; i < length; i++)
+    {
+        sum = (sum ^ data[i]) * 1099511628211u;
+    }
+    return (uint32_t)(sum ^ (sum >> 32));
+}
+
+/**
+ * Returns the number of bytes a saved map's table and entry arrays take.
+ * @param header
+ * @param tableBytes Set to the size of the slots or bucket table.
+ * @return Size of the slots or table plus the entries or links.
+ */
+static uint64_t hashMapFileArrayBytes(const struct HashMapFileHeader* header,
+                                      uint64_t* tableBytes)
+{
+    if (header->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        *tableBytes = (uint64_t)sizeof(HashSlot) * header->capacity;
+    }
+    else
+    {
+        *tableBytes = (uint64_t)sizeof(uint32_t) * header->capacity;
+    }
+    return *tableBytes + (uint64_t)sizeof(HashFileEntry) * header->size;
+}
+
+/**
+ * @param map A map still read from its file.
+ * @return The saved arrays and keys after the file's header.
+ */
+static const char* hashMapFileBody(const HashMap* map)
+{
+    if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        return (const char*)map->slots;
+    }
+    return (const char*)map->fileTable;
+}
+
+/**
+ * Writes the built table to the file in the layout hashMapLoad reads in
+ * place. A map still read from its file is written out as it was loaded.
+ * The map must use one of the hash functions hashFunctionByName knows.
+ * @param map
+ * @param file File opened for binary writing.
+ * @return 1 on success, 0 if the map's hash function has no name or the
+ *         file could not be written.
+ */
+int hashMapSave(HashMap* map, FILE* file)
+{
+	assert(map);
+	assert(file);
+	
+	struct HashMapFileHeader header;
+	uint64_t tableBytes;
+	uint64_t arrayBytes;
+	char *body = NULL;
+	char *keys = NULL;
+	uint32_t keyBytes = 0;
+	int ok;
+	
+	if (map->fileEntries) {
+		const char *saved = hashMapFileBody(map) - sizeof(header);
+		memcpy(&header, saved, sizeof(header));
+		uint64_t savedBytes = sizeof(header) + header.keyBytes
+			+ hashMapFileArrayBytes(&header, &tableBytes);
+		return fwrite(saved, 1, savedBytes, file) == savedBytes;
+	}
+	
+	header.hashFunction = NUM_HASH_FUNCTIONS;
+	for (int i = 0; i < NUM_HASH_FUNCTIONS; ++i) {
+		if (hashFunctions[i].function == map->hashFunction) {
+			header.hashFunction = i;
+		}
+	}
+	if (header.hashFunction == NUM_HASH_FUNCTIONS) {
+		return 0;
+	}
+	
+	header.magic = HASH_MAP_FILE_MAGIC;
+	header.version = HASH_MAP_FILE_VERSION;
+	header.backend = map->backend;
+	header.capacity = map->capacity;
+	header.size = map->size;
+	
+	// count the key bytes first so everything fits in one buffer
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		for (int i = 0; i < map->size; ++i) {
+			keyBytes += strlen(map->entries[i].key) + 1;
+		}
+	}
+	else {
+		for (int i = 0; i < map->capacity; ++i) {
+			for (HashLink *link = map->table[i]; link; link = link->next) {
+				keyBytes += strlen(link->key) + 1;
+			}
+		}
+	}
+	header.keyBytes = keyBytes;
+	arrayBytes = hashMapFileArrayBytes(&header, &tableBytes);
+	// zeroed, so every chain ends and every entry's next is 0
+	body = calloc(arrayBytes + keyBytes + 1, 1);
+	assert(body);
+	keys = body + arrayBytes;
+	keyBytes = 0;
+	
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		HashFileEntry *entries = (HashFileEntry *)(body + tableBytes);
+		memcpy(body, map->slots, tableBytes);
+		for (int i = 0; i < map->size; ++i) {
+			entries[i].key = keyBytes;
+			entries[i].hash = map->entries[i].hash;
+			entries[i].value = map->entries[i].value;
+			strcpy(keys + keyBytes, map->entries[i].key);
+			keyBytes += strlen(map->entries[i].key) + 1;
+		}
+	}
+	else {
+		uint32_t *table = (uint32_t *)body;
+		HashFileEntry *links = (HashFileEntry *)(body + tableBytes);
+		uint32_t numLinks = 0;
+		for (int i = 0; i < map->capacity; ++i) {
+			table[i] = map->table[i] ? numLinks + 1 : 0;
+			for (HashLink *link = map->table[i]; link; link = link->next) {
+				links[numLinks].key = keyBytes;
+				links[numLinks].hash = link->hash;
+				links[numLinks].value = link->value;
+				links[numLinks].next = link->next ? numLinks + 2 : 0;
+				strcpy(keys + keyBytes, link->key);
+				keyBytes += strlen(link->key) + 1;
+				++numLinks;
+			}
+		}
+	}
+	
+	header.checksum = hashMapChecksum(2166136261u, body,
+		arrayBytes + keyBytes);
+	header.headerChecksum = hashMapChecksum(2166136261u, &header,
+		offsetof(struct HashMapFileHeader, headerChecksum));
+	
+	ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(body, 1, arrayBytes + keyBytes, file)
+			== arrayBytes + keyBytes;
+	
+	free(body);
+	return ok;
+}
+
+/**
+ * Checks that every offset and index in a saved map is in range: that
+ * each key starts inside the keys, that open addressing has exactly one
+ * slot per entry, and that each chain is the next run of links, so every
+ * link is in one chain.
+ * @param header The saved map's header, already checked.
+ * @param body The arrays and keys after the header.
+ * @return 1 if the saved map is sound, 0 otherwise.
+ */
+static int hashMapFileSound(const struct HashMapFileHeader* header,
+                            const char* body)
+{
+	uint64_t tableBytes;
+	uint32_t size = header->size;
+	
+	hashMapFileArrayBytes(header, &tableBytes);
+	const HashFileEntry *entries = (const HashFileEntry *)(body + tableBytes);
+	
+	for (uint32_t i = 0; i < size; ++i) {
+		if (entries[i].key >= header->keyBytes) {
+			return 0;
+		}
+	}
+	
+	if (header->backend == HASH_MAP_OPEN_ADDRESSING) {
+		const HashSlot *slots = (const HashSlot *)body;
+		uint32_t filled = 0;
+		// exactly one slot per entry, which leaves empty ones to end probes
+		for (uint32_t i = 0; i < header->capacity; ++i) {
+			if (slots[i].entry == HASH_SLOT_EMPTY) {
+				continue;
+			}
+			if (slots[i].entry < 0 || (uint32_t)slots[i].entry >= size) {
+				return 0;
+			}
+			++filled;
+		}
+		return filled == size;
+	}
+	
+	// each chain is a run of links, each pointing at the one after it
+	const uint32_t *table = (const uint32_t *)body;
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < header->capacity; ++i) {
+		if (table[i] == 0) {
+			continue;
+		}
+		if (table[i] != next + 1 || next >= size) {
+			return 0;
+		}
+		while (1) {
+			const HashFileEntry *link = &entries[next++];
+			if (link->next == 0) {
+				break;
+			}
+			if (link->next != next + 1 || next >= size) {
+				return 0;
+			}
+		}
+	}
+	return next == size;
+}
+
+/**
+ * Checks everything about a map from hashMapLoad that loading leaves to
+ * lookups: the checksum of the saved arrays and keys, and that every
+ * saved offset and index is in range. This reads the whole file, so it
+ * is meant to be run once, when a file is written or is suspect, rather
+ * than by every process that loads it.
+ * @param map
+ * @return 1 if the map is sound, 0 if its file is damaged. Maps that are
+ *         not read from a file, or have been changed since, are always
+ *         sound.
+ */
+int hashMapVerify(HashMap* map)
+{
+	assert(map);
+	
+	struct HashMapFileHeader header;
+	uint64_t tableBytes;
+	uint64_t length;
+	const char *body = NULL;
+	
+	if (!(map->fileEntries)) {
+		return 1;
+	}
+	body = hashMapFileBody(map);
+	memcpy(&header, body - sizeof(header), sizeof(header));
+	length = hashMapFileArrayBytes(&header, &tableBytes) + header.keyBytes;
+	return hashMapChecksum(2166136261u, body, length) == header.checksum
+		&& hashMapFileSound(&header, body);
+}
+
+/**
+ * Reads everything left in the file into one allocated buffer.
+ * @param file
+ * @param length Set to the number of bytes read.
+ * @return The buffer.
+ */
+static char* hashMapReadRest(FILE* file, size_t* length)
+{
+	long start = ftell(file);
+	long end = -1;
+	size_t capacity = ARENA_BLOCK_SIZE;
+	size_t count;
+	char *buffer = NULL;
+	
+	if (start >= 0 && fseek(file, 0, SEEK_END) == 0) {
+		end = ftell(file);
+		if (fseek(file, start, SEEK_SET) != 0) end = -1;
+	}
+	if (end >= start && start >= 0) {
+		capacity = end - start + 1;
+	}
+	
+	*length = 0;
+	buffer = malloc(capacity);
+	assert(buffer);
+	while ((count = fread(buffer + *length, 1, capacity - *length, file))
+		   > 0) {
+		*length += count;
+		if (*length == capacity) {
+			capacity *= 2;
+			buffer = realloc(buffer, capacity);
+			assert(buffer);
+		}
+	}
+	return buffer;
+}
+
+/**
+ * Creates a map from a file written by hashMapSave without rebuilding it.
+ * The file is mapped into memory read only, so every process that loads
+ * it shares the same pages, or read in one go when it cannot be mapped.
+ * Lookups then probe the saved slots or walk the saved chains right where
+ * they are, turning each saved key offset and link index into an address
+ * as they go. Loading itself only checks the header and that the file is
+ * as long as the header says; hashMapVerify checks the rest. Nothing is
+ * hashed, probed, copied or allocated per key.
+ * 
+ * The values of a loaded map are read only: pointers to them from
+ * hashMapGet, the iterator and hashMapForEach must not be written
+ * through. The map can still be changed with the other functions, which
+ * first copy its arrays out of the file.
+ * @param file File opened for binary reading, positioned at the start of
+ *        the saved map.
+ * @return The allocated map, or NULL if the file is not a saved map of
+ *         this version or its header does not match its length.
+ */
+HashMap* hashMapLoad(FILE* file)
+{
+	assert(file);
+	
+	struct HashMapFileHeader header;
+	HashMap *map = NULL;
+	char *image = NULL;
+	size_t imageBytes = 0;
+	char *start = NULL;
+	char *body = NULL;
+	size_t length = 0;
+	int mapped = 0;
+	uint64_t tableBytes;
+	uint64_t arrayBytes;
+	long offset = ftell(file);
+	long end = -1;
+	
+	// map the whole file, as offsets into a mapping must be page aligned
+	if (offset >= 0 && offset % sizeof(uint32_t) == 0
+		&& fseek(file, 0, SEEK_END) == 0) {
+		end = ftell(file);
+		if (fseek(file, offset, SEEK_SET) != 0) end = -1;
+	}
+	if (end > offset) {
+		image = mmap(NULL, end, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+		if (image != MAP_FAILED) {
+			mapped = 1;
+			imageBytes = end;
+			start = image + offset;
+			length = end - offset;
+		}
+	}
+	if (!mapped) {
+		image = hashMapReadRest(file, &imageBytes);
+		start = image;
+		length = imageBytes;
+	}
+	
+	int valid = length >= sizeof(header);
+	if (valid) {
+		memcpy(&header, start, sizeof(header));
+		valid = header.magic == HASH_MAP_FILE_MAGIC
+			&& header.version == HASH_MAP_FILE_VERSION
+			&& header.headerChecksum == hashMapChecksum(2166136261u,
+				&header, offsetof(struct HashMapFileHeader, headerChecksum))
+			&& header.backend <= HASH_MAP_OPEN_ADDRESSING
+			&& header.hashFunction < NUM_HASH_FUNCTIONS
+			&& header.capacity > 0 && header.capacity <= INT32_MAX
+			&& header.size <= INT32_MAX;
+	}
+	// open addressing needs a power of two with an empty slot to spare
+	if (valid && header.backend == HASH_MAP_OPEN_ADDRESSING) {
+		valid = (header.capacity & (header.capacity - 1)) == 0
+			&& header.size < header.capacity;
+	}
+	// the saved sizes have to account for every byte of the file, and the
+	// last key has to end in it
+	if (valid) {
+		arrayBytes = hashMapFileArrayBytes(&header, &tableBytes);
+		body = start + sizeof(header);
+		valid = sizeof(header) + arrayBytes + header.keyBytes == length
+			&& (header.keyBytes > 0
+				? body[arrayBytes + header.keyBytes - 1] == '\0'
+				: header.size == 0);
+	}
+	if (!valid) {
+		if (mapped) {
+			munmap(image, imageBytes);
+		}
+		else {
+			free(image);
+		}
+		return NULL;
+	}
+	
+	map = malloc(sizeof(HashMap));
+	assert(map);
+	map->backend = header.backend;
+	map->hashFunction = hashFunctions[header.hashFunction].function;
+	map->capacity = header.capacity;
+	map->size = header.size;
+	map->table = NULL;
+	map->slots = NULL;
+	map->entries = NULL;
+	map->entryCapacity = 0;
+	map->arena = NULL;
+	map->keyBuffers = NULL;
+	map->freeLinks = NULL;
+	map->fileEntries = (const HashFileEntry *)(body + tableBytes);
+	map->fileTable = NULL;
+	map->fileKeys = body + arrayBytes;
+	map->image = image;
+	map->imageBytes = imageBytes;
+	map->imageMapped = mapped;
+	if (map->backend == HASH_MAP_OPEN_ADDRESSING) {
+		map->slots = (HashSlot *)body;
+	}
+	else {
+		map->fileTable = (const uint32_t *)body;
+	}
+	return map;
+}
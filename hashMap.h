@@ -6,32 +6,170 @@
  * Assignment 5
  */
 
-#define HASH_FUNCTION hashFunction1
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hash function new maps start with; see hashMapSetHashFunction.
+#define HASH_FUNCTION hashFunctionFnv1a
 #define MAX_TABLE_LOAD 1
+// Open addressing tables grow before probe sequences get long.
+#define MAX_SLOT_LOAD 0.75
+// Size of the first block in a map's arena; later blocks double up to the
+// maximum.
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_MAX_BLOCK_SIZE 4194304
+// Identifies files written by hashMapSave; the version changes whenever
+// their layout does.
+#define HASH_MAP_FILE_MAGIC 0x4d445053u
+#define HASH_MAP_FILE_VERSION 4
+// Entry index of an open addressing slot that holds nothing.
+#define HASH_SLOT_EMPTY -1
 
 typedef struct HashMap HashMap;
 typedef struct HashLink HashLink;
+typedef struct HashSlot HashSlot;
+typedef struct HashEntry HashEntry;
+typedef struct HashFileEntry HashFileEntry;
+typedef struct HashArenaBlock HashArenaBlock;
+typedef struct HashMapIterator HashMapIterator;
+
+typedef enum
+{
+    // Each bucket holds a linked list of heap allocated links.
+    HASH_MAP_CHAINED,
+    // Entries live back to back in one array, indexed by a slot array in
+    // which collisions probe linearly to the next slot.
+    HASH_MAP_OPEN_ADDRESSING
+} HashMapBackend;
+
+typedef uint32_t (*HashFunction)(const char* key);
+// Called by hashMapForEach with each key, a pointer to its value and the
+// caller's context.
+typedef void (*HashMapVisitor)(const char* key, int* value, void* context);
 
 struct HashLink
 {
     char* key;
+    // Hash of the key, cached so resizing never recomputes it.
+    uint32_t hash;
     int value;
     HashLink* next;
 };
 
+struct HashSlot
+{
+    // Full hash of the key, compared before the entry is looked at.
+    uint32_t hash;
+    // Index into the map's entries, HASH_SLOT_EMPTY if the slot is empty.
+    int32_t entry;
+};
+
+struct HashEntry
+{
+    char* key;
+    uint32_t hash;
+    int value;
+};
+
+/*
+ * An entry or link as hashMapSave writes it, with numbers where the map
+ * in memory has pointers, so a loaded map can be read in place.
+ */
+struct HashFileEntry
+{
+    // Offset of the key in the file's keys.
+    uint32_t key;
+    uint32_t hash;
+    int32_t value;
+    // Index plus one of the next link in a chained map's bucket, 0 at the
+    // end of the chain and in an open addressing map.
+    uint32_t next;
+};
+
+/*
+ * Block of memory links and key strings are carved from. A map's blocks
+ * form a list headed by the block currently being filled.
+ */
+struct HashArenaBlock
+{
+    HashArenaBlock* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
 struct HashMap
 {
+    HashMapBackend backend;
+    // Buckets of a chained map, NULL for open addressing.
     HashLink** table;
+    // Slots of an open addressing map, NULL for chaining.
+    HashSlot* slots;
+    // Entries of an open addressing map, the first size of them in use.
+    // Removing an entry moves the last one into its place.
+    HashEntry* entries;
+    // Number of entries allocated.
+    int entryCapacity;
     // Number of links in the table.
     int size;
-    // Number of buckets in the table.
+    // Number of buckets (or slots) in the table.
     int capacity;
+    // Hash function used to pick a key's bucket.
+    HashFunction hashFunction;
+    // Memory all links and key strings are allocated from.
+    HashArenaBlock* arena;
+    // Buffers handed out by hashMapKeyBuffer.
+    HashArenaBlock* keyBuffers;
+    // Removed links waiting to be reused.
+    HashLink* freeLinks;
+    // Saved entries or links, bucket table and keys of a map from
+    // hashMapLoad, read where they sit in its file until the map is first
+    // changed; NULL for other maps. The slots of an open addressing map
+    // are used from the file too.
+    const HashFileEntry* fileEntries;
+    const uint32_t* fileTable;
+    const char* fileKeys;
+    // File a map from hashMapLoad was mapped or read into; its keys stay
+    // in use after the map is changed. NULL for other maps.
+    char* image;
+    size_t imageBytes;
+    // 1 if image is a mapping of the file, 0 if it was allocated.
+    int imageMapped;
 };
 
+/*
+ * Walks every entry of a map without copying anything. Usually declared on
+ * the stack and set up with hashMapItrInit. The map must not be changed
+ * while it is being iterated, apart from writing through value pointers,
+ * which a map from hashMapLoad does not allow either.
+ */
+struct HashMapIterator
+{
+    HashMap* map;
+    // Link hashMapItrNext returns next from a chained map, NULL at the end.
+    HashLink* nextLink;
+    // Bucket of nextLink, or the next entry of an open addressing map.
+    int nextIndex;
+};
+
+uint32_t hashFunction1(const char* key);
+uint32_t hashFunction2(const char* key);
+uint32_t hashFunctionFnv1a(const char* key);
+uint32_t hashFunctionMurmur3(const char* key);
+HashFunction hashFunctionByName(const char* name);
+const char* hashFunctionName(HashFunction hashFunction);
+
 HashMap* hashMapNew(int capacity);
+HashMap* hashMapNewBackend(int capacity, HashMapBackend backend);
 void hashMapDelete(HashMap* map);
+void hashMapSetHashFunction(HashMap* map, HashFunction hashFunction);
+void hashMapReserve(HashMap* map, int size);
 int* hashMapGet(HashMap* map, const char* key);
 void hashMapPut(HashMap* map, const char* key, int value);
+int* hashMapFindOrInsert(HashMap* map, const char* key, int value);
+int* hashMapFindOrInsertBorrowed(HashMap* map, const char* key, int value);
+char* hashMapKeyBuffer(HashMap* map, size_t size);
 void hashMapRemove(HashMap* map, const char* key);
 int hashMapContainsKey(HashMap* map, const char* key);
 
@@ -41,4 +179,13 @@ int hashMapEmptyBuckets(HashMap* map);
 float hashMapTableLoad(HashMap* map);
 void hashMapPrint(HashMap* map);
 
+void hashMapItrInit(HashMap* map, HashMapIterator* itr);
+int hashMapItrHasNext(HashMapIterator* itr);
+void hashMapItrNext(HashMapIterator* itr, const char** key, int** value);
+void hashMapForEach(HashMap* map, HashMapVisitor visitor, void* context);
+
+int hashMapSave(HashMap* map, FILE* file);
+HashMap* hashMapLoad(FILE* file);
+int hashMapVerify(HashMap* map);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "levenshteinAutomaton.h"
+#include "hashMap.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct LevenshteinSearch LevenshteinSearch;
+
+/*
+ * State of levenshteinAutomatonFind while it walks the graph.
+ */
+struct LevenshteinSearch
+{
+    const LevenshteinAutomaton* automaton;
+    const Dawg* dawg;
+    int cutoff;
+    EditBatchVisitor visitor;
+    void* context;
+    int edgesFollowed;
+};
+
+/**
+ * Builds the automaton breadth first from the query's first row, working
+ * out each state's transition for every class and adding the rows not
+ * seen before as new states. The rows are keyed in a HashMap as strings
+ * of their cells plus one, which keeps the null byte out of them.
+ * @param automaton
+ * @param query
+ * @param length Number of characters in query.
+ * @param maxDistance Between 0 and LEVENSHTEIN_AUTOMATON_MAX_DISTANCE.
+ */
+void levenshteinAutomatonInit(LevenshteinAutomaton* automaton,
+                              const char* query, int length,
+                              int maxDistance)
+{
+    assert(automaton);
+    assert(query);
+    assert(maxDistance >= 0
+           && maxDistance <= LEVENSHTEIN_AUTOMATON_MAX_DISTANCE);
+
+    int clamp = maxDistance + 1;
+    int width = length + 1;
+    automaton->maxDistance = maxDistance;
+    memset(automaton->classes, 0, sizeof(automaton->classes));
+    automaton->numClasses = 1;
+    for (int i = 0; i < length; i++)
+    {
+        uint8_t c = query[i];
+        if (automaton->classes[c] == 0)
+        {
+            automaton->classes[c] = automaton->numClasses++;
+        }
+    }
+
+    int capacity = 64;
+    uint8_t* rows = malloc((size_t)capacity * width);
+    char* key = malloc(width + 1);
+    automaton->transitions = malloc(sizeof(int) * capacity
+                                    * automaton->numClasses);
+    automaton->distances = malloc(capacity);
+    automaton->minimums = malloc(capacity);
+    assert(rows && key && automaton->transitions && automaton->distances
+           && automaton->minimums);
+    HashMap* registry = hashMapNewBackend(capacity, HASH_MAP_OPEN_ADDRESSING);
+
+    // the first row, already known to be new
+    for (int j = 0; j < width; j++)
+    {
+        rows[j] = j < clamp ? j : clamp;
+        key[j] = rows[j] + 1;
+    }
+    key[width] = '\0';
+    hashMapPut(registry, key, 0);
+    automaton->numStates = 1;
+
+    uint8_t* next = malloc(width);
+    assert(next);
+    for (int state = 0; state < automaton->numStates; state++)
+    {
+        const uint8_t* row = rows + (size_t)state * width;
+        automaton->distances[state] = row[length];
+        automaton->minimums[state] = clamp;
+        for (int j = 0; j < width; j++)
+        {
+            if (row[j] < automaton->minimums[state])
+            {
+                automaton->minimums[state] = row[j];
+            }
+        }
+
+        for (int c = 0; c < automaton->numClasses; c++)
+        {
+            int smallest = next[0] = row[0] < clamp ? row[0] + 1 : clamp;
+            for (int j = 1; j < width; j++)
+            {
+                int cell = row[j - 1]
+                           + (automaton->classes[(uint8_t)query[j - 1]]
+                              != c);
+                if (row[j] + 1 < cell)
+                {
+                    cell = row[j] + 1;
+                }
+                if (next[j - 1] + 1 < cell)
+                {
+                    cell = next[j - 1] + 1;
+                }
+                next[j] = cell < clamp ? cell : clamp;
+                if (next[j] < smallest)
+                {
+                    smallest = next[j];
+                }
+            }
+
+            int target = -1;
+            if (smallest <= maxDistance)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    key[j] = next[j] + 1;
+                }
+                target = *hashMapFindOrInsert(registry, key,
+                                              automaton->numStates);
+                if (target == automaton->numStates)
+                {
+                    if (automaton->numStates == capacity)
+                    {
+                        capacity *= 2;
+                        rows = realloc(rows, (size_t)capacity * width);
+                        automaton->transitions = realloc(
+                            automaton->transitions,
+                            sizeof(int) * capacity * automaton->numClasses);
+                        automaton->distances = realloc(automaton->distances,
+                                                       capacity);
+                        automaton->minimums = realloc(automaton->minimums,
+                                                      capacity);
+                        assert(rows && automaton->transitions
+                               && automaton->distances
+                               && automaton->minimums);
+                        row = rows + (size_t)state * width;
+                    }
+                    memcpy(rows + (size_t)target * width, next, width);
+                    automaton->numStates++;
+                }
+            }
+            automaton->transitions[state * automaton->numClasses + c] =
+                target;
+        }
+    }
+    hashMapDelete(registry);
+    free(rows);
+    free(next);
+    free(key);
+}
+
+/**
+ * Frees the automaton's states.
+ * @param automaton
+ */
+void levenshteinAutomatonCleanUp(LevenshteinAutomaton* automaton)
+{
+    assert(automaton);
+    free(automaton->transitions);
+    free(automaton->distances);
+    free(automaton->minimums);
+    automaton->transitions = NULL;
+    automaton->distances = NULL;
+    automaton->minimums = NULL;
+    automaton->numStates = 0;
+}
+
+/**
+ * Runs the automaton along every path below a node of the graph, in label
+ * order, leaving a path as soon as the automaton has no state for it or
+ * the state's closest string is over the cutoff.
+ * @param search
+ * @param node
+ * @param state The automaton's state after the path to the node.
+ * @param rank Number of words before the node's in sorted order.
+ */
+static void levenshteinAutomatonWalk(LevenshteinSearch* search, int node,
+                                     int state, int rank)
+{
+    const LevenshteinAutomaton* automaton = search->automaton;
+    const Dawg* dawg = search->dawg;
+    const DawgNode* current = &dawg->nodes[node];
+    const int* transitions = automaton->transitions
+                             + state * automaton->numClasses;
+
+    if (current->final && automaton->distances[state] <= search->cutoff)
+    {
+        search->cutoff = search->visitor(dawg->order[rank],
+                                         automaton->distances[state],
+                                         search->context);
+        if (search->cutoff > automaton->maxDistance)
+        {
+            search->cutoff = automaton->maxDistance;
+        }
+    }
+    rank += current->final;
+    for (int e = current->firstEdge;
+         e < current->firstEdge + current->numEdges && search->cutoff >= 0;
+         e++)
+    {
+        const DawgEdge* edge = &dawg->edges[e];
+        int next = transitions[automaton->classes[edge->label]];
+        search->edgesFollowed++;
+        if (next >= 0 && automaton->minimums[next] <= search->cutoff)
+        {
+            levenshteinAutomatonWalk(search, edge->target, next, rank);
+        }
+        rank += dawg->nodes[edge->target].numWords;
+    }
+}
+
+/**
+ * Reports every word of the graph within the cutoff of the automaton's
+ * query to the visitor, in sorted order, like dawgFindNear. Each edge
+ * followed costs one table lookup, and only paths the automaton still
+ * has a state for are followed, so the work grows with the number of
+ * prefixes close to the query rather than with the size of the graph.
+ * Both are only read, so threads can share them.
+ * @param automaton
+ * @param dawg
+ * @param cutoff Largest distance to report, capped at the automaton's
+ *        maxDistance.
+ * @param visitor Returns the cutoff for the rest of the walk.
+ * @param context Passed through to the visitor.
+ * @return Number of edges followed.
+ */
+int levenshteinAutomatonFind(const LevenshteinAutomaton* automaton,
+                             const Dawg* dawg, int cutoff,
+                             EditBatchVisitor visitor, void* context)
+{
+    assert(automaton);
+    assert(dawg);
+    assert(visitor);
+
+    LevenshteinSearch search;
+    search.automaton = automaton;
+    search.dawg = dawg;
+    search.cutoff = cutoff < automaton->maxDistance
+                    ? cutoff : automaton->maxDistance;
+    search.visitor = visitor;
+    search.context = context;
+    search.edgesFollowed = 0;
+    if (dawg->size > 0 && search.cutoff >= 0
+        && automaton->minimums[0] <= search.cutoff)
+    {
+        levenshteinAutomatonWalk(&search, dawg->root, 0, 0);
+    }
+    return search.edgesFollowed;
+}
@@ -0,0 +1,53 @@
+#ifndef LEVENSHTEIN_AUTOMATON_H
+#define LEVENSHTEIN_AUTOMATON_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "dawg.h"
+#include "editDistanceBatch.h"
+#include <stdint.h>
+
+// Largest distance an automaton is built for; the number of states grows
+// quickly past it.
+#define LEVENSHTEIN_AUTOMATON_MAX_DISTANCE 2
+
+typedef struct LevenshteinAutomaton LevenshteinAutomaton;
+
+/*
+ * A deterministic automaton accepting every string within maxDistance
+ * edits of a query. A state is a row of the edit distance matrix against
+ * the query with every cell over maxDistance clamped, and a transition
+ * works out the next row; rows with every cell clamped have no state.
+ * Characters the query does not use all behave the same, so transitions
+ * are by class: one per distinct query character and one for the rest.
+ */
+struct LevenshteinAutomaton
+{
+    int maxDistance;
+    // Class of each character, 0 for characters not in the query.
+    uint8_t classes[256];
+    int numClasses;
+    int numStates;
+    // Next state for state s and class c at s * numClasses + c, -1 if
+    // no string through it is accepted.
+    int* transitions;
+    // Distance between the query and a string ending in each state, or
+    // maxDistance + 1 if it is further.
+    uint8_t* distances;
+    // Smallest cell of each state's row; no string through a state is
+    // closer than this.
+    uint8_t* minimums;
+};
+
+void levenshteinAutomatonInit(LevenshteinAutomaton* automaton,
+                              const char* query, int length,
+                              int maxDistance);
+void levenshteinAutomatonCleanUp(LevenshteinAutomaton* automaton);
+int levenshteinAutomatonFind(const LevenshteinAutomaton* automaton,
+                             const Dawg* dawg, int cutoff,
+                             EditBatchVisitor visitor, void* context);
+
+#endif
@@ -5,416 +5,245 @@
  * Date: 2019-11-22
  */
 
+// for sysconf
+#define _POSIX_C_SOURCE 200809L
+
 #include "hashMap.h"
+#include "dictionary.h"
+#include "editDistance.h"
+#include "suggest.h"
 #include <assert.h>
 #include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <unistd.h>
 
-/*
- * Iterator to go through every filled entry in a hash table
- */
-struct HashMapIterator {
-	struct HashMap * map;
-	struct HashLink * currentLink;
-	struct HashLink * frontSentinel;
-	int currentBucket;
-};
-
-/*
- * object to hold a key-value pair
- */
-struct Association {
-	char * key;
-	int value;
-};
+// word list loaded by default
+#define TEXT_DICTIONARY "dictionary.txt"
+// extension of the word list a compiled dictionary falls back to
+#define TEXT_EXTENSION ".txt"
+// closest words suggested for a misspelled word by default
+#define NUM_SUGGESTIONS 5
+// characters deleted from each word by --method deletes by default
+#define DELETE_DISTANCE 2
 
 /*
- * creates a new Association wth the given key-value pair
- * @param key
- * @param value
- * @return pointer to allocated struct Association
+ * work out the word list a compiled dictionary is rebuilt from when it
+ * cannot be loaded: the same path with its extension replaced by .txt,
+ * as make builds dictionary.bin from dictionary.txt
+ * @param path the compiled dictionary
+ * @return allocated path, or NULL if it would be path itself
  */
-struct Association * assocNew(char * key, int value) {
-	struct Association * temp;
-	temp = malloc(sizeof(struct Association));
-	assert(temp);
+static char * fallbackPath(const char * path) {
+	const char * slash = strrchr(path, '/');
+	const char * dot = strrchr(path, '.');
+	size_t length = strlen(path);
+	char * fallback = NULL;
 	
-	temp->key = malloc(sizeof(char) * (strlen(key) + 1));
-	assert(temp->key);
-	strcpy(temp->key, key);
-	
-	temp->value = value;
-	
-	return temp;
-}
-
-/*
- * deallocates a struct Association
- * @param assoc
- */
-void assocDestroy(struct Association * assoc) {
-	assert(assoc);
-	assert(assoc->key);
-	free(assoc->key);
-	free(assoc);
+	if (dot && (!slash || dot > slash + 1)) length = dot - path;
+	if (strcmp(path + length, TEXT_EXTENSION) == 0) return NULL;
+	fallback = malloc(length + sizeof(TEXT_EXTENSION));
+	assert(fallback);
+	memcpy(fallback, path, length);
+	strcpy(fallback + length, TEXT_EXTENSION);
+	return fallback;
 }
 
 /*
- * initializes a hash map iterator to the given map and sets currentLink to
- * a dummy value whose next pointer points to the first entry in the hash
- * table
- * @param map
- * @param itr
+ * load the dictionary at path. a file written with --compile is used in
+ * place with the table layout it was compiled with; anything else is
+ * parsed as a word list. a compiled file that is damaged or from another
+ * version falls back to the word list beside it (see fallbackPath).
+ * loading only checks a compiled file's header and size unless verify is
+ * set
+ * @param path
+ * @param backend table layout for a dictionary built from a word list
+ * @param backendChosen 1 if the user asked for the layout, which is then
+ *        reported when a compiled file overrides it
+ * @param hashFunction hash function to switch to, or NULL to keep the
+ *        compiled one (or the default for a word list)
+ * @param counts 1 if each word of a word list is followed by a count
+ * @param verify 1 to check all of a compiled file with hashMapVerify
+ * @return the loaded map, or NULL if nothing could be loaded
  */
-void hashMapItrInit(struct HashMap * map, struct HashMapIterator * itr) {
-	assert(map);
-	assert(itr);
-	
-	itr->map = map;
+static HashMap * openDictionary(const char * path, HashMapBackend backend,
+								int backendChosen, HashFunction hashFunction,
+								int counts, int verify) {
+	HashMap * map = NULL;
+	uint32_t magic = 0;
+	char * fallback = NULL;
+	FILE * file = fopen(path, "rb");
 	
-	// set up front sentinel so first call to next is not a special case
-	if (itr->frontSentinel) { //make reinitializing safe
-		free(itr->frontSentinel);
+	if (!file) {
+		fprintf(stderr, "Could not open %s\n", path);
+		return NULL;
 	}
-	itr->frontSentinel = malloc(sizeof(struct HashLink));
-	assert(itr->frontSentinel);
-	
-	itr->frontSentinel->key = NULL;
-	itr->frontSentinel->value = 0;
-	itr->frontSentinel->next = itr->map->table[0];
-	
-	itr->currentLink = itr->frontSentinel;
-	
-	itr->currentBucket = 0;
-}
-
-/*
- * return a pointer to an initialized hash map iterator for the hash
- * table map
- * @param map
- * @return pointer to allocated iterator
- */
-struct HashMapIterator * hashMapItrNew(struct HashMap * map) {
-	assert(map);
 	
-	struct HashMapIterator * temp = NULL;
-	temp = malloc(sizeof(struct HashMapIterator));
-	assert(temp);
-	
-	temp->frontSentinel = NULL;  // so init does not try to free it
-	
-	hashMapItrInit(map, temp);
-	
-	return temp;
-}
-
-/*
- * deallocates a hash map iterator object
- * @param itr
- */
-void hashMapItrDestroy(struct HashMapIterator * itr) {
-	assert(itr);
-	assert(itr->frontSentinel);
-	free(itr->frontSentinel);
-	free(itr);
-}
-
-/*
- * Determine if the map itr is for has a next link
- * @param itr
- * @return 0 if a next entry exists; 0 if it does not
- */
-int hashMapItrHasNext(struct HashMapIterator * itr) {
-	assert(itr);
-	assert(itr->map);
-	struct HashLink * temp = itr->currentLink;
-
-	int startBucket;
-	
-	/*
-	 * if the next link exits, return true; otherwise, we have reached the
-	 * end of the chain, so proceed to the following buckets until a filled
-	 * entry is found (true) or the end of the table is reached (false)
-	 */
-	if (temp->next) {
-		return 1;
-	}
-	else {
-		startBucket = itr->currentBucket + 1;
-		for (int i = startBucket; i < itr->map->capacity; ++i) {
-			temp = itr->map->table[i];
-			if (temp) {
-				return 1;
+	if (fread(&magic, sizeof(magic), 1, file) == 1
+		&& magic == HASH_MAP_FILE_MAGIC) {
+		rewind(file);
+		map = hashMapLoad(file);
+		fclose(file);
+		if (map && verify && !hashMapVerify(map)) {
+			hashMapDelete(map);
+			map = NULL;
+		}
+		if (map) {
+			if (backendChosen && map->backend != backend) {
+				fprintf(stderr, "--table ignored: %s was compiled with the "
+						"%s layout\n", path, map->backend == HASH_MAP_CHAINED
+						? "chained" : "open");
 			}
+			if (hashFunction) hashMapSetHashFunction(map, hashFunction);
+			return map;
 		}
-	}
-	return 0;
-}
-
-/*
- * Return the contents of the next entry in the hash table as a pointer
- * to a new association. must be interleaved with hashMapItrHasNext() to
- * function properly
- * @param itr
- * @return pointer to an allocated struct Association containing the key
- *         and value of the next link in the hash table associated with itr
- */
-struct Association * hashMapItrNext(struct HashMapIterator * itr) {
-	assert(itr);
-	assert(hashMapItrHasNext(itr));
-	
-	/*
-	 * go to the next link in the current bucket, if it exists, return its
-	 * key-value pair, otherwise, proceed to following buckets until a filled
-	 * one is found and return the key-value pair
-	 */
-	itr->currentLink = itr->currentLink->next;
-	
-	if (!(itr->currentLink)) { // end of current chain
-		++(itr->currentBucket);
-		// try additional chains
-		while (itr->currentBucket < itr->map->capacity
-			   && !(itr->currentLink)) {
-			itr->currentLink = itr->map->table[itr->currentBucket];
-			if (!(itr->currentLink)) ++(itr->currentBucket);
+		fallback = fallbackPath(path);
+		if (!fallback) {
+			fprintf(stderr, "%s is damaged or from another version\n", path);
+			return NULL;
+		}
+		fprintf(stderr, "%s is damaged or from another version, loading %s\n",
+				path, fallback);
+		file = fopen(fallback, "rb");
+		if (!file) {
+			fprintf(stderr, "Could not open %s\n", fallback);
+			free(fallback);
+			return NULL;
 		}
+		free(fallback);
 	}
+	rewind(file);
 	
-	//build the return data (copy of info in currentLink)
-	struct Association * temp;
-	temp = assocNew(itr->currentLink->key, itr->currentLink->value);
-	
-	return temp;
+	map = hashMapNewBackend(1000, backend);
+	if (hashFunction) hashMapSetHashFunction(map, hashFunction);
+	loadDictionary(file, map, counts);
+	fclose(file);
+	return map;
 }
 
 /*
- * calculate and return the levenshtein distance between 2 strings.
- * Based on pseudocode from https://en.wikipedia.org/wiki/Levenshtein_distance#Iterative_with_two_matrix_rows
- * @param string1
- * @param string2
- * @return levenshtein distance between string1 and string2
+ * write the loaded dictionary to path in the compiled format, then load
+ * it back and verify all of it once, so workers loading it need not
+ * @param map
+ * @param path
+ * @return 0 on success, 1 otherwise
  */
-int levenshtein(char * string1, char * string2) {
-	const int NUM_VECTORS = 2;
-	int * vectors[NUM_VECTORS];
-	int * temp = NULL;
-	int length1 = strlen(string1);
-	int length2 = strlen(string2);
-	int vecLength = length2 + 1;
-	int levDist = 0;
-	
-	int del, ins, sub, min;
+static int compileDictionary(HashMap * map, const char * path) {
+	FILE * file = fopen(path, "wb");
+	HashMap * written = NULL;
+	int ok;
 	
-	// allocate the two vectors to use
-	for (int i = 0; i < NUM_VECTORS; ++i) {
-		vectors[i] = malloc(sizeof(int) * vecLength);
-		assert(vectors[i]);
+	if (!file) {
+		fprintf(stderr, "Could not create %s\n", path);
+		return 1;
 	}
-	
-	/*
-	 * initialize vector0 to the levenshtien disances of string2's
-	 * substrings from a null string
-	 */
-	for (int i = 0; i < vecLength; ++i) {
-		vectors[0][i] = i;
+	ok = hashMapSave(map, file);
+	ok = (fclose(file) == 0) && ok;
+	if (!ok) {
+		fprintf(stderr, "Could not write %s\n", path);
+		remove(path);
+		return 1;
 	}
-	
-	for (int i = 0; i < length1; ++i) {
-		/*
-		 * calculate vector1 from vector0. vector1 represents the
-		 * levenshtein distance between substrings for string1 and substrings
-		 * of string2. the results of the previous substring of string1 are
-		 * in vector0
-		 */
-		
-		//first element is between substrings of 1 and null string
-		vectors[1][0] = i + 1;
-		
-		//subsequent elements based on needed edit
-		for (int j = 0; j < length2; ++j) {
-			del = vectors[0][j+1] + 1; //deletion edit
-			ins = vectors[1][j] + 1; //insertion edit
-			//substituion edit
-			if (string1[i] == string2[j]) sub = vectors[0][j];
-			else sub = vectors[0][j] + 1;
-			
-			//determine minimum edit distance
-			min = del;
-			if (ins < min) min = ins;
-			if (sub < min) min = sub;
-			vectors[1][j + 1] = min;
-		}
-		
-		/*
-		 * swap vetors to preserve vector0 as previous iteration and
-		 * vector1 as working space.
-		 */
-		temp = vectors[0];
-		vectors[0] = vectors[1];
-		vectors[1] = temp;
-		temp = NULL;
+	file = fopen(path, "rb");
+	if (file) {
+		written = hashMapLoad(file);
+		fclose(file);
 	}
-	
-	// distance between full strings is last element in vector0
-	levDist = vectors[0][length2];
-	
-	for (int i = 0; i < NUM_VECTORS; ++i) {
-		free(vectors[i]);
-		vectors[i] = NULL;
+	ok = written && hashMapVerify(written)
+		&& hashMapSize(written) == hashMapSize(map);
+	if (written) hashMapDelete(written);
+	if (!ok) {
+		fprintf(stderr, "Could not verify %s\n", path);
+		remove(path);
+		return 1;
 	}
-	
-	return levDist;
+	printf("Compiled %d words into %s\n", hashMapSize(map), path);
+	return 0;
 }
 
 /*
- * iterate through the map and return an array of associations with the
- * smallest levenshtein distances stored in the value field. Map must have
- * the distances loaded in the value field to function correctly
+ * build a DAWG of every word in the map, which answers lookups without
+ * the map
  * @param map
- * @param numSuggestions
- * @return pointer to allocated array of struct Associations of
- *         size numSuggestions
+ * @param dawg
  */
-struct Association ** suggest(HashMap *map, int numSuggestions) {
-	assert(map);
-	assert(numSuggestions <= hashMapSize(map));
-	
-	struct Association ** outputArray = NULL;
-	struct Association * current = NULL;
-	struct Association * temp = NULL;
-	struct HashMapIterator * itr = NULL;
-	itr = hashMapItrNew(map);
-	int i;
-	
-	// set up the return structure
-	outputArray = malloc(sizeof(struct Association *) * numSuggestions);
-	assert(outputArray);
-	for (i = 0; i < numSuggestions; ++i) {
-		outputArray[i] = assocNew("", 255); // 255 is biggest buffer in main
-	}
+static void buildDawg(HashMap * map, Dawg * dawg) {
+	int size = hashMapSize(map);
+	const char ** words = malloc(sizeof(char *) * (size + 1));
+	int * lengths = malloc(sizeof(int) * (size + 1));
+	HashMapIterator itr;
+	int * value;
 	
-	/*
-	 * Iterate through the hash table. If the value of current is smaller
-	 * than an element of the output array, remove the largest value element
-	 * from the array. Maintain the array sorted ascending by value
-	 */
-	while (hashMapItrHasNext(itr)) {
-		current = hashMapItrNext(itr);
-		i = 0;
-		while (i < numSuggestions && !temp) {
-			if (current->value < outputArray[i]->value){
-				temp = outputArray[numSuggestions - 1];
-				for (int j = numSuggestions - 1; j > i; --j) {
-					outputArray[j] = outputArray[j - 1];
-				}
-				outputArray[i] = current;
-				current = temp;
-			}
-			++i;
-		}
-		temp = NULL;
-		assocDestroy(current);
+	assert(words);
+	assert(lengths);
+	hashMapItrInit(map, &itr);
+	for (int i = 0; hashMapItrHasNext(&itr); ++i) {
+		hashMapItrNext(&itr, &words[i], &value);
+		lengths[i] = strlen(words[i]);
 	}
-	
-	hashMapItrDestroy(itr);
-	return outputArray;
+	dawgInit(dawg, words, lengths, size);
+	free(words);
+	free(lengths);
 }
 
-/**
- * Allocates a string for the next word in the file and returns it. This string
- * is null terminated. Returns NULL after reaching the end of the file.
- * @param file
- * @return Allocated string or NULL.
- */
-char* nextWord(FILE* file)
-{
-    int maxLength = 16;
-    int length = 0;
-    char* word = malloc(sizeof(char) * maxLength);
-    while (1)
-    {
-        char c = fgetc(file);
-        if ((c >= '0' && c <= '9') ||
-            (c >= 'A' && c <= 'Z') ||
-            (c >= 'a' && c <= 'z') ||
-            c == '\'')
-        {
-            if (length + 1 >= maxLength)
-            {
-                maxLength *= 2;
-                word = realloc(word, maxLength);
-            }
-            word[length] = c;
-            length++;
-        }
-        else if (length > 0 || c == EOF)
-        {
-            break;
-        }
-    }
-    if (length == 0)
-    {
-        free(word);
-        return NULL;
-    }
-    word[length] = '\0';
-    return word;
-}
-
-/**
- * Loads the contents of the file into the hash map.
- * @param file
+/*
+ * check each named file (or stdin for "-" or when no files are given)
+ * against the dictionary and stream the results to stdout
  * @param map
+ * @param dawg graph to look words up in instead of the map, or NULL
+ * @param numFiles
+ * @param fileNames
+ * @return 0 if every input could be read, 1 otherwise
  */
-void loadDictionary(FILE* file, HashMap* map)
-{
-    // FIXME: implement
-	assert(file);
-	assert(map);
-	char * currentWord = nextWord(file);
-	while (currentWord) {
-		hashMapPut(map, currentWord, 0);
-		free(currentWord);
-		currentWord = nextWord(file);
-	}
+static int runBatch(HashMap * map, const Dawg * dawg, int numFiles,
+					const char ** fileNames) {
+	static char outputBuffer[BATCH_BLOCK_SIZE];
+	int status;
+	
+	setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+	status = checkFiles(map, dawg, numFiles, fileNames, stdin, stdout);
+	fflush(stdout);
+	return status;
 }
 
-/**
- * Checks the spelling of the word provded by the user. If the word is spelled incorrectly,
- * print the 5 closest words as determined by a metric like the Levenshtein distance.
- * Otherwise, indicate that the provded word is spelled correctly. Use dictionary.txt to
- * create the dictionary.
- * @param argc
- * @param argv
- * @return
+/*
+ * prompt the user for words until they enter "quit", printing whether each
+ * one is spelled correctly and the closest dictionary words if it is not.
+ * suggestions are sorted by distance, ties going to the more frequent
+ * word, then alphabetically; the result is the same on any number of
+ * threads. the dictionary is only read, never written. with the dawg and
+ * automaton methods, words are looked up in the suggestion index's graph
+ * as well
+ * @param map
+ * @param numThreads threads to search for the closest words with
+ * @param numSuggestions closest words to print, 1 to
+ *        SUGGEST_MAX_SUGGESTIONS
+ * @param method how to find the closest words
+ * @param maxDistance distance the method indexes the words to, if any
  */
-int main(int argc, const char** argv)
-{
-    // FIXME: implement
-	struct Association * tempAssoc = NULL;
-	struct HashMapIterator * hashItr = NULL;
-	struct Association ** suggestions = NULL;
-	const int NUM_SUGGESTIONS = 5;
+static void runInteractive(HashMap * map, int numThreads,
+		int numSuggestions, SuggestMethod method, int maxDistance) {
+	Suggestion suggestions[SUGGEST_MAX_SUGGESTIONS];
+	int numFound;
 	char lowerCaseWord[256];
+	EditDistance engine;
+	SuggestionIndex * index = suggestionIndexNew(map);
+	
+	editDistanceInit(&engine);
+	suggestionIndexSetThreads(index, numThreads);
+	suggestionIndexUseMethod(index, method, maxDistance);
 	
-    HashMap* map = hashMapNew(1000);
-
-    FILE* file = fopen("dictionary.txt", "r");
-    clock_t timer = clock();
-    loadDictionary(file, map);
-    timer = clock() - timer;
-    printf("Dictionary loaded in %f seconds\n", (float)timer / (float)CLOCKS_PER_SEC);
-    fclose(file);
-
     char inputBuffer[256];
     int quit = 0;
     while (!quit)
     {
         printf("Enter a word or \"quit\" to quit: ");
-        scanf("%s", inputBuffer);
+        if (scanf("%255s", inputBuffer) != 1) {
+			break;
+		}
 
         // Implement the spell checker code here..
 		
@@ -424,37 +253,27 @@ int main(int argc, const char** argv)
 			lowerCaseWord[i] = tolower(lowerCaseWord[i]);
 		}
 		
-		if (hashMapContainsKey(map, lowerCaseWord)) {
+		if (isWord(map, method == SUGGEST_DAWG || method == SUGGEST_AUTOMATON
+				? &index->dawg : NULL, lowerCaseWord)) {
 			// input is spelled correctly
 			printf("The inputted word \"%s\" is spelled correctly\n", inputBuffer);
 		}
 		else {
 			// input is misspelled
 			
-			// iterate through the dictionary computing levenshtein distances
-			hashItr = hashMapItrNew(map);
-			while (hashMapItrHasNext(hashItr)) {
-				tempAssoc = hashMapItrNext(hashItr);
-				tempAssoc->value = levenshtein(lowerCaseWord, tempAssoc->key);
-				hashMapPut(map, tempAssoc->key, tempAssoc->value);
-				assocDestroy(tempAssoc);
-			}
-			hashMapItrDestroy(hashItr);
+			// find the closest dictionary words
+			numFound = suggestionIndexFind(index, &engine, lowerCaseWord,
+				suggestions, numSuggestions);
 			//hashMapPrint(map);
 			
-			// generate vector of suggetions
-			suggestions = suggest(map, NUM_SUGGESTIONS);
-			
 			// print the suggestions
 			printf("The inputted word \"%s\" is spelled incorrectly\n",
 				inputBuffer);
 			printf("Did you mean:\n");
-			for (int i = 0; i < NUM_SUGGESTIONS; ++i) {
-				printf("%s\n", suggestions[i]->key);
-				/*printf("%s, %d\n", suggestions[i]->key, suggestions[i]->value);*/
-				assocDestroy(suggestions[i]);
+			for (int i = 0; i < numFound; ++i) {
+				printf("%s\n", index->words[suggestions[i].index]);
+				/*printf("%s, %d\n", index->words[suggestions[i].index], suggestions[i].distance);*/
 			}
-			free(suggestions);
 		}
 		
 		strcpy(inputBuffer, lowerCaseWord);
@@ -466,7 +285,243 @@ int main(int argc, const char** argv)
         }
 		
     }
+	
+	editDistanceCleanUp(&engine);
+	suggestionIndexDelete(index);
+}
 
-    hashMapDelete(map);
-    return 0;
+/*
+ * print command line usage to stderr
+ * @param program
+ */
+static void usage(const char * program) {
+	fprintf(stderr,
+			"usage: %s [options]                interactive mode\n"
+			"       %s [options] -b [file ...]  check files ('-' or none for stdin)\n"
+			"\n"
+			"options:\n"
+			"  --hash NAME   dictionary hash function: sum, weighted, fnv1a,\n"
+			"                murmur3 (default %s)\n"
+			"  --table TYPE  dictionary table layout: open (open addressing,\n"
+			"                default) or chained; a compiled dictionary\n"
+			"                keeps the layout it was compiled with\n"
+			"  --dict FILE   word list or compiled dictionary to load\n"
+			"                (default %s)\n"
+			"  --counts      the word list is a frequency list, each word\n"
+			"                followed on its line by a count that breaks\n"
+			"                ties between suggestions\n"
+			"  --compile OUT save the loaded dictionary in the compiled format,\n"
+			"                which later runs can load with --dict OUT\n"
+			"  --verify      check all of a compiled dictionary before using\n"
+			"                it, not just its header and size; --compile\n"
+			"                checks the file it writes\n"
+			"  --threads N   threads to search for suggestions with, 1 to %d\n"
+			"                (default: one per processor)\n"
+			"  --suggestions K\n"
+			"                closest words to suggest for a misspelled word,\n"
+			"                1 to %d (default %d)\n"
+			"  --method NAME how to find suggestions: scan (measure every word,\n"
+			"                default), deletes (look up the word with up to\n"
+			"                --max-distance characters deleted; slower to\n"
+			"                start, much faster per word), bktree (search\n"
+			"                a BK-tree of the dictionary), dawg (walk a\n"
+			"                minimal word graph of the dictionary, which\n"
+			"                also answers lookups; batch mode then frees\n"
+			"                the hash map) or automaton (run a Levenshtein\n"
+			"                automaton of the word over the dawg, then\n"
+			"                walking it one distance further at a time\n"
+			"                when too few words are that close)\n"
+			"  --max-distance D\n"
+			"                distance the deletes method indexes, 1 to %d,\n"
+			"                or the automaton method accepts, 1 to %d\n"
+			"                (default %d); each step costs several times the\n"
+			"                memory or time\n"
+			"\n"
+			"Batch mode writes one tab separated line per word:\n"
+			"    <file> <line> <column> <word> <ok|misspelled>\n",
+			program, program, hashFunctionName(HASH_FUNCTION),
+			TEXT_DICTIONARY, SUGGEST_MAX_THREADS, SUGGEST_MAX_SUGGESTIONS,
+			NUM_SUGGESTIONS, DELETE_INDEX_MAX_DISTANCE,
+			LEVENSHTEIN_AUTOMATON_MAX_DISTANCE, DELETE_DISTANCE);
+}
+
+/**
+ * Checks the spelling of the word provded by the user. If the word is spelled incorrectly,
+ * print the 5 closest words as determined by a metric like the Levenshtein distance.
+ * Otherwise, indicate that the provded word is spelled correctly. Use dictionary.txt to
+ * create the dictionary.
+ *
+ * With -b, every word in the given files (or stdin) is checked instead and
+ * the results are streamed to stdout for other programs to consume.
+ * @param argc
+ * @param argv
+ * @return
+ */
+int main(int argc, const char** argv)
+{
+	int batch = 0;
+	int argIndex = 1;
+	int status = 0;
+	HashFunction hashFunction = NULL;
+	HashMapBackend backend = HASH_MAP_OPEN_ADDRESSING;
+	int backendChosen = 0;
+	int counts = 0;
+	int verify = 0;
+	const char * dictionaryPath = TEXT_DICTIONARY;
+	const char * compilePath = NULL;
+	long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+	int numSuggestions = NUM_SUGGESTIONS;
+	SuggestMethod method = SUGGEST_SCAN;
+	int maxDistance = DELETE_DISTANCE;
+	
+	if (numThreads < 1) numThreads = 1;
+	if (numThreads > SUGGEST_MAX_THREADS) numThreads = SUGGEST_MAX_THREADS;
+	
+	// parse options; anything after them is an input file for batch mode
+	while (argIndex < argc && argv[argIndex][0] == '-'
+		   && argv[argIndex][1] != '\0') {
+		if (strcmp(argv[argIndex], "-b") == 0
+			|| strcmp(argv[argIndex], "--batch") == 0) {
+			batch = 1;
+		}
+		else if (strcmp(argv[argIndex], "--hash") == 0
+				 && argIndex + 1 < argc) {
+			++argIndex;
+			hashFunction = hashFunctionByName(argv[argIndex]);
+			if (!hashFunction) {
+				fprintf(stderr, "Unknown hash function %s\n", argv[argIndex]);
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[argIndex], "--table") == 0
+				 && argIndex + 1 < argc) {
+			++argIndex;
+			if (strcmp(argv[argIndex], "chained") == 0) {
+				backend = HASH_MAP_CHAINED;
+			}
+			else if (strcmp(argv[argIndex], "open") == 0) {
+				backend = HASH_MAP_OPEN_ADDRESSING;
+			}
+			else {
+				usage(argv[0]);
+				return 2;
+			}
+			backendChosen = 1;
+		}
+		else if (strcmp(argv[argIndex], "--dict") == 0
+				 && argIndex + 1 < argc) {
+			dictionaryPath = argv[++argIndex];
+		}
+		else if (strcmp(argv[argIndex], "--counts") == 0) {
+			counts = 1;
+		}
+		else if (strcmp(argv[argIndex], "--verify") == 0) {
+			verify = 1;
+		}
+		else if (strcmp(argv[argIndex], "--compile") == 0
+				 && argIndex + 1 < argc) {
+			compilePath = argv[++argIndex];
+		}
+		else if (strcmp(argv[argIndex], "--threads") == 0
+				 && argIndex + 1 < argc) {
+			numThreads = atoi(argv[++argIndex]);
+			if (numThreads < 1 || numThreads > SUGGEST_MAX_THREADS) {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[argIndex], "--suggestions") == 0
+				 && argIndex + 1 < argc) {
+			numSuggestions = atoi(argv[++argIndex]);
+			if (numSuggestions < 1
+				|| numSuggestions > SUGGEST_MAX_SUGGESTIONS) {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[argIndex], "--method") == 0
+				 && argIndex + 1 < argc) {
+			++argIndex;
+			if (strcmp(argv[argIndex], "scan") == 0) {
+				method = SUGGEST_SCAN;
+			}
+			else if (strcmp(argv[argIndex], "deletes") == 0) {
+				method = SUGGEST_DELETES;
+			}
+			else if (strcmp(argv[argIndex], "bktree") == 0) {
+				method = SUGGEST_BK_TREE;
+			}
+			else if (strcmp(argv[argIndex], "dawg") == 0) {
+				method = SUGGEST_DAWG;
+			}
+			else if (strcmp(argv[argIndex], "automaton") == 0) {
+				method = SUGGEST_AUTOMATON;
+			}
+			else {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[argIndex], "--max-distance") == 0
+				 && argIndex + 1 < argc) {
+			maxDistance = atoi(argv[++argIndex]);
+			if (maxDistance < 1
+				|| maxDistance > DELETE_INDEX_MAX_DISTANCE) {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+		else if (strcmp(argv[argIndex], "--") == 0) {
+			++argIndex;
+			break;
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+		++argIndex;
+	}
+	if ((!batch && argIndex < argc) || (method == SUGGEST_AUTOMATON
+			&& maxDistance > LEVENSHTEIN_AUTOMATON_MAX_DISTANCE)) {
+		usage(argv[0]);
+		return 2;
+	}
+	
+    clock_t timer = clock();
+    HashMap* map = openDictionary(dictionaryPath, backend, backendChosen,
+		hashFunction, counts, verify);
+    timer = clock() - timer;
+	if (!map) {
+		return 1;
+	}
+	// keep stdout machine readable in batch mode
+    fprintf(batch ? stderr : stdout, "Dictionary loaded in %f seconds\n",
+			(float)timer / (float)CLOCKS_PER_SEC);
+
+	if (compilePath) {
+		status = compileDictionary(map, compilePath);
+	}
+	else if (batch && (method == SUGGEST_DAWG
+			|| method == SUGGEST_AUTOMATON)) {
+		// the graph is all batch mode needs, and far smaller than the map
+		Dawg dawg;
+		buildDawg(map, &dawg);
+		hashMapDelete(map);
+		map = NULL;
+		status = runBatch(NULL, &dawg, argc - argIndex, argv + argIndex);
+		dawgCleanUp(&dawg);
+	}
+	else if (batch) {
+		status = runBatch(map, NULL, argc - argIndex, argv + argIndex);
+	}
+	else {
+		runInteractive(map, (int)numThreads, numSuggestions, method,
+			maxDistance);
+	}
+
+	if (map) {
+		hashMapDelete(map);
+	}
+    return status;
 }
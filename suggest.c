@@ -0,0 +1,787 @@
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "suggest.h"
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cutoff a query starts with; no word that long gets suggested.
+#define SUGGEST_MAX_DISTANCE (UINT8_MAX - 1)
+
+typedef struct SuggestQuery SuggestQuery;
+typedef struct SuggestWorker SuggestWorker;
+typedef struct SuggestDeepening SuggestDeepening;
+typedef struct SuggestWord SuggestWord;
+
+/*
+ * The query being answered, shared by all threads scanning for it.
+ */
+struct SuggestQuery
+{
+    SuggestionIndex* index;
+    EditDistancePattern pattern;
+    int numSuggestions;
+    // Next partitions to hand out going up and down in length from the
+    // query's, only changed under the pool's lock.
+    int nextUp;
+    int nextDown;
+};
+
+/*
+ * One thread's share of a query: its scratch memory and a heap of the best
+ * words it has found.
+ */
+struct SuggestWorker
+{
+    SuggestPool* pool;
+    const SuggestQuery* query;
+    EditDistance* engine;
+    Suggestion* best;
+    int count;
+    int capacity;
+    // Index of the heap's root once the heap is full; words after it lose
+    // a tie at its distance. INT_MAX while the heap has room.
+    int ties;
+    // Scratch memory of a helper thread; worker 0 uses the caller's.
+    EditDistance ownEngine;
+    pthread_t thread;
+};
+
+/*
+ * Helper threads kept waiting between queries. Worker 0 is the thread
+ * asking the query; the others start on every new generation and report
+ * back through finished.
+ */
+struct SuggestPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t finished;
+    // Held for a whole query; callers that find it taken scan alone.
+    pthread_mutex_t busy;
+    SuggestWorker* workers;
+    int numThreads;
+    SuggestQuery* query;
+    unsigned long generation;
+    // Helper threads still scanning the current query.
+    int running;
+    int stop;
+};
+
+/*
+ * One walk of the DAWG by SUGGEST_AUTOMATON once its automaton has found
+ * too few words: the worker's heap and the largest distance to report.
+ */
+struct SuggestDeepening
+{
+    SuggestWorker* worker;
+    int cutoff;
+};
+
+/*
+ * A word of a map with its length and frequency, sorted by
+ * suggestionIndexNew.
+ */
+struct SuggestWord
+{
+    const char* word;
+    int length;
+    int frequency;
+};
+
+/**
+ * Orders suggestions by distance, then by frequency, most frequent first,
+ * then alphabetically. The index's words are already sorted in that
+ * order, so after the distance only their positions need comparing, and
+ * no two suggestions tie.
+ * @param a
+ * @param b
+ * @return 1 if a comes before b, 0 otherwise.
+ */
+static int suggestionBefore(const Suggestion* a, const Suggestion* b)
+{
+    if (a->distance != b->distance)
+    {
+        return a->distance < b->distance;
+    }
+    return a->index < b->index;
+}
+
+/**
+ * Moves the heap entry at i down until neither child comes after it.
+ * @param heap
+ * @param count Number of entries in the heap.
+ * @param i
+ */
+static void suggestHeapDown(Suggestion* heap, int count, int i)
+{
+    Suggestion entry = heap[i];
+    while (2 * i + 1 < count)
+    {
+        int child = 2 * i + 1;
+        if (child + 1 < count
+            && suggestionBefore(&heap[child], &heap[child + 1]))
+        {
+            child++;
+        }
+        if (!suggestionBefore(&entry, &heap[child]))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+}
+
+/**
+ * Offers a suggestion to a heap of at most capacity entries whose root is
+ * the one that comes last. While the heap has room the suggestion is
+ * added; after that it replaces the root if it comes before it.
+ * @param heap
+ * @param count Number of entries in the heap, updated.
+ * @param capacity
+ * @param suggestion
+ */
+static void suggestHeapOffer(Suggestion* heap, int* count, int capacity,
+                             const Suggestion* suggestion)
+{
+    if (*count < capacity)
+    {
+        int i = (*count)++;
+        while (i > 0 && suggestionBefore(&heap[(i - 1) / 2], suggestion))
+        {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = *suggestion;
+    }
+    else if (suggestionBefore(suggestion, &heap[0]))
+    {
+        heap[0] = *suggestion;
+        suggestHeapDown(heap, *count, 0);
+    }
+}
+
+/**
+ * Sorts a heap built by suggestHeapOffer into order, first to last.
+ * @param heap
+ * @param count
+ */
+static void suggestHeapSort(Suggestion* heap, int count)
+{
+    for (int last = count - 1; last > 0; last--)
+    {
+        Suggestion root = heap[0];
+        heap[0] = heap[last];
+        heap[last] = root;
+        suggestHeapDown(heap, last, 0);
+    }
+}
+
+/**
+ * editDistanceBatchScan visitor that offers the word to the worker's heap
+ * of best words. Once the heap is full only words no further away than
+ * its root can get in; one at the same distance can still win if it comes
+ * before the root in the index, so the cutoff stays at the root's
+ * distance and the root's index becomes the worker's ties.
+ * @param word Index of the word.
+ * @param distance
+ * @param context Pointer to the SuggestWorker.
+ * @return Cutoff for the rest of the scan.
+ */
+static int suggestVisit(int word, int distance, void* context)
+{
+    SuggestWorker* worker = context;
+    const SuggestQuery* query = worker->query;
+    Suggestion suggestion;
+
+    suggestion.index = word;
+    suggestion.distance = distance;
+    suggestHeapOffer(worker->best, &worker->count, query->numSuggestions,
+                     &suggestion);
+    if (worker->count < query->numSuggestions)
+    {
+        return SUGGEST_MAX_DISTANCE;
+    }
+    worker->ties = worker->best[0].index;
+    return worker->best[0].distance;
+}
+
+/**
+ * dawgFindNear visitor that offers the word like suggestVisit but never
+ * lets the walk's cutoff rise past the deepening's.
+ * @param word Index of the word.
+ * @param distance
+ * @param context Pointer to the SuggestDeepening.
+ * @return Cutoff for the rest of the walk.
+ */
+static int suggestDeepeningVisit(int word, int distance, void* context)
+{
+    SuggestDeepening* deepening = context;
+    int cutoff = suggestVisit(word, distance, deepening->worker);
+    return cutoff < deepening->cutoff ? cutoff : deepening->cutoff;
+}
+
+/**
+ * Takes the partition whose length is nearest the query's of those not
+ * handed out yet, the shorter one on a tie. Must be called under the
+ * pool's lock.
+ * @param query
+ * @param cutoff The calling worker's cutoff.
+ * @return The partition, or -1 if every one left is further from the
+ *         query's length than the cutoff.
+ */
+static int suggestNextPartition(SuggestQuery* query, int cutoff)
+{
+    const SuggestionIndex* index = query->index;
+    const EditBatchGroup* groups = index->batch.groups;
+    int upGap = INT_MAX;
+    int downGap = INT_MAX;
+
+    if (query->nextUp < index->numPartitions)
+    {
+        upGap = groups[index->partitions[query->nextUp]].length
+                - query->pattern.length;
+    }
+    if (query->nextDown >= 0)
+    {
+        downGap = query->pattern.length
+                  - groups[index->partitions[query->nextDown]].length;
+    }
+    if ((upGap < downGap ? upGap : downGap) > cutoff)
+    {
+        return -1;
+    }
+    return upGap < downGap ? query->nextUp++ : query->nextDown--;
+}
+
+/**
+ * Scans the worker's query: alone, the whole batch nearest lengths first;
+ * in a pool, partitions nearest the query's length first until every one
+ * left is too far from it.
+ * @param worker
+ */
+static void suggestWorkerRun(SuggestWorker* worker)
+{
+    SuggestQuery* query = (SuggestQuery*)worker->query;
+    SuggestionIndex* index = query->index;
+    int cutoff = SUGGEST_MAX_DISTANCE;
+
+    if (worker->capacity < query->numSuggestions)
+    {
+        free(worker->best);
+        worker->best = malloc(sizeof(Suggestion) * query->numSuggestions);
+        assert(worker->best);
+        worker->capacity = query->numSuggestions;
+    }
+    worker->count = 0;
+    worker->ties = INT_MAX;
+    if (!worker->pool)
+    {
+        editDistanceBatchScanNearest(worker->engine, &index->batch,
+                                     &query->pattern, cutoff, &worker->ties,
+                                     suggestVisit, worker);
+        return;
+    }
+    while (1)
+    {
+        pthread_mutex_lock(&worker->pool->lock);
+        int partition = suggestNextPartition(query, cutoff);
+        pthread_mutex_unlock(&worker->pool->lock);
+        if (partition < 0)
+        {
+            return;
+        }
+        int last = partition + 1 < index->numPartitions
+                   ? index->partitions[partition + 1]
+                   : index->batch.numGroups;
+        cutoff = editDistanceBatchScanGroups(worker->engine, &index->batch,
+                                             index->partitions[partition],
+                                             last, &query->pattern, cutoff,
+                                             &worker->ties, suggestVisit,
+                                             worker);
+    }
+}
+
+/**
+ * Body of a helper thread: scans every query the pool starts until the
+ * pool stops.
+ * @param argument Pointer to the thread's SuggestWorker.
+ * @return NULL
+ */
+static void* suggestWorkerMain(void* argument)
+{
+    SuggestWorker* worker = argument;
+    SuggestPool* pool = worker->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1)
+    {
+        while (!pool->stop && pool->generation == seen)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop)
+        {
+            break;
+        }
+        seen = pool->generation;
+        worker->query = pool->query;
+        pthread_mutex_unlock(&pool->lock);
+
+        suggestWorkerRun(worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--(pool->running) == 0)
+        {
+            pthread_cond_signal(&pool->finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Starts numThreads - 1 helper threads, each with its own scratch memory.
+ * @param numThreads
+ * @return The allocated pool.
+ */
+static SuggestPool* suggestPoolNew(int numThreads)
+{
+    SuggestPool* pool = malloc(sizeof(SuggestPool));
+    assert(pool);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    pthread_mutex_init(&pool->busy, NULL);
+    pool->numThreads = numThreads;
+    pool->query = NULL;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stop = 0;
+    pool->workers = calloc(numThreads, sizeof(SuggestWorker));
+    assert(pool->workers);
+    for (int i = 0; i < numThreads; i++)
+    {
+        SuggestWorker* worker = &pool->workers[i];
+        worker->pool = pool;
+        editDistanceInit(&worker->ownEngine);
+        worker->engine = &worker->ownEngine;
+        if (i > 0)
+        {
+            int error = pthread_create(&worker->thread, NULL,
+                                       suggestWorkerMain, worker);
+            assert(error == 0);
+            (void)error;
+        }
+    }
+    return pool;
+}
+
+/**
+ * Stops and joins the helper threads and frees the pool.
+ * @param pool
+ */
+static void suggestPoolDelete(SuggestPool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->numThreads; i++)
+    {
+        if (i > 0)
+        {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+        editDistanceCleanUp(&pool->workers[i].ownEngine);
+        free(pool->workers[i].best);
+    }
+    free(pool->workers);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finished);
+    pthread_mutex_destroy(&pool->busy);
+    free(pool);
+}
+
+/**
+ * qsort comparison of two SuggestWords, the more frequent first, then
+ * alphabetically.
+ * @param a
+ * @param b
+ * @return Negative, 0 or positive as a comes before, with or after b.
+ */
+static int suggestCompareWords(const void* a, const void* b)
+{
+    const SuggestWord* first = a;
+    const SuggestWord* second = b;
+    if (first->frequency != second->frequency)
+    {
+        return first->frequency > second->frequency ? -1 : 1;
+    }
+    return strcmp(first->word, second->word);
+}
+
+/**
+ * hashMapForEach visitor that appends the entry to a SuggestionIndex's
+ * words, taking its value as its frequency.
+ * @param key
+ * @param value
+ * @param context Pointer to the SuggestionIndex.
+ */
+static void suggestIndexVisit(const char* key, int* value, void* context)
+{
+    SuggestionIndex* index = context;
+    index->words[index->size] = key;
+    index->lengths[index->size] = strlen(key);
+    index->frequencies[index->size] = *value;
+    index->size++;
+}
+
+/**
+ * Lays out every word of the map for suggestionIndexFind, with the word's
+ * value in the map as its frequency for breaking ties, to be scanned
+ * by the calling thread alone until suggestionIndexSetThreads says
+ * otherwise. The words are numbered once here in the order ties are
+ * broken in, most frequent first, then alphabetically, so a query only
+ * compares their numbers and every engine built on them can tell from a
+ * word's number alone whether it could win a tie.
+ * @param map
+ * @return The allocated index.
+ */
+SuggestionIndex* suggestionIndexNew(HashMap* map)
+{
+    assert(map);
+    SuggestionIndex* index = malloc(sizeof(SuggestionIndex));
+    int size = hashMapSize(map);
+    assert(index);
+    index->words = malloc(sizeof(char*) * (size + 1));
+    index->lengths = malloc(sizeof(int) * (size + 1));
+    index->frequencies = malloc(sizeof(int) * (size + 1));
+    assert(index->words && index->lengths && index->frequencies);
+    index->size = 0;
+    hashMapForEach(map, suggestIndexVisit, index);
+    SuggestWord* sorted = malloc(sizeof(SuggestWord) * (index->size + 1));
+    assert(sorted);
+    for (int i = 0; i < index->size; i++)
+    {
+        sorted[i].word = index->words[i];
+        sorted[i].length = index->lengths[i];
+        sorted[i].frequency = index->frequencies[i];
+    }
+    qsort(sorted, index->size, sizeof(SuggestWord), suggestCompareWords);
+    for (int i = 0; i < index->size; i++)
+    {
+        index->words[i] = sorted[i].word;
+        index->lengths[i] = sorted[i].length;
+        index->frequencies[i] = sorted[i].frequency;
+    }
+    free(sorted);
+    editDistanceBatchInit(&index->batch, index->words, index->lengths,
+                          index->size);
+    index->partitions = NULL;
+    index->pool = NULL;
+    index->method = SUGGEST_SCAN;
+    suggestionIndexSetThreads(index, 1);
+    return index;
+}
+
+/**
+ * Stops the index's threads and frees it. The map is not touched.
+ * @param index
+ */
+void suggestionIndexDelete(SuggestionIndex* index)
+{
+    assert(index);
+    if (index->pool)
+    {
+        suggestPoolDelete(index->pool);
+    }
+    suggestionIndexUseMethod(index, SUGGEST_SCAN, 0);
+    editDistanceBatchCleanUp(&index->batch);
+    free(index->partitions);
+    free(index->words);
+    free(index->lengths);
+    free(index->frequencies);
+    free(index);
+}
+
+/**
+ * Sets how many threads scan the index for each query: the calling thread
+ * and numThreads - 1 helpers, which wait between queries. The batch is cut
+ * into SUGGEST_PARTITIONS_PER_THREAD partitions per thread of about equal
+ * work, and again wherever the length changes, and the partitions nearest
+ * the query's length are handed out first to whichever thread is free.
+ * The suggestions do not depend on the number of threads.
+ * @param index
+ * @param numThreads Between 1 and SUGGEST_MAX_THREADS.
+ */
+void suggestionIndexSetThreads(SuggestionIndex* index, int numThreads)
+{
+    assert(index);
+    assert(numThreads >= 1 && numThreads <= SUGGEST_MAX_THREADS);
+
+    if (index->pool)
+    {
+        suggestPoolDelete(index->pool);
+        index->pool = NULL;
+    }
+    free(index->partitions);
+
+    // work of a group is its number of character rows
+    const EditDistanceBatch* batch = &index->batch;
+    long totalRows = 0;
+    for (int g = 0; g < batch->numGroups; g++)
+    {
+        totalRows += batch->groups[g].length + 1;
+    }
+    int wanted = numThreads == 1 ? 1
+                 : numThreads * SUGGEST_PARTITIONS_PER_THREAD;
+    index->partitions = malloc(sizeof(int)
+                               * (wanted + batch->maxLength + 1));
+    assert(index->partitions);
+    index->numPartitions = 0;
+    long rows = 0;
+    int shares = 0;
+    for (int g = 0; g < batch->numGroups; g++)
+    {
+        // start a new partition each time another share of rows is done,
+        // and at every new length
+        if (rows * wanted >= totalRows * shares && shares < wanted)
+        {
+            index->partitions[index->numPartitions++] = g;
+            shares++;
+        }
+        else if (batch->groups[g].length != batch->groups[g - 1].length)
+        {
+            index->partitions[index->numPartitions++] = g;
+        }
+        rows += batch->groups[g].length + 1;
+    }
+
+    if (numThreads > 1)
+    {
+        index->pool = suggestPoolNew(numThreads);
+    }
+}
+
+/**
+ * Sets how the index finds the words closest to a query. SUGGEST_DELETES
+ * builds a DeleteIndex of the words with up to maxDistance characters
+ * deleted: queries with enough words that close are answered from it by
+ * the calling thread alone, and the rest are scanned. SUGGEST_BK_TREE
+ * builds a BkTree and SUGGEST_DAWG a Dawg, which the calling thread alone
+ * searches for every query. SUGGEST_AUTOMATON builds a Dawg too, and each
+ * query first runs an automaton of the words within maxDistance over it,
+ * then walks it with a cutoff one larger at a time until enough are found.
+ * The suggestions are the same whichever method finds them.
+ * @param index
+ * @param method
+ * @param maxDistance Between 1 and DELETE_INDEX_MAX_DISTANCE for
+ *        SUGGEST_DELETES, between 1 and LEVENSHTEIN_AUTOMATON_MAX_DISTANCE
+ *        for SUGGEST_AUTOMATON, ignored otherwise.
+ */
+void suggestionIndexUseMethod(SuggestionIndex* index, SuggestMethod method,
+                              int maxDistance)
+{
+    assert(index);
+    if (index->method == SUGGEST_DELETES)
+    {
+        deleteIndexCleanUp(&index->deletes);
+    }
+    else if (index->method == SUGGEST_BK_TREE)
+    {
+        bkTreeCleanUp(&index->bkTree);
+    }
+    else if (index->method == SUGGEST_DAWG
+             || index->method == SUGGEST_AUTOMATON)
+    {
+        dawgCleanUp(&index->dawg);
+    }
+    index->method = method;
+    if (method == SUGGEST_DELETES)
+    {
+        deleteIndexInit(&index->deletes, index->words, index->lengths,
+                        index->size, maxDistance);
+    }
+    else if (method == SUGGEST_BK_TREE)
+    {
+        EditDistance engine;
+        editDistanceInit(&engine);
+        bkTreeInit(&index->bkTree, &engine, index->words, index->lengths,
+                   index->size);
+        editDistanceCleanUp(&engine);
+    }
+    else if (method == SUGGEST_DAWG || method == SUGGEST_AUTOMATON)
+    {
+        assert(method == SUGGEST_DAWG
+               || (maxDistance >= 1
+                   && maxDistance <= LEVENSHTEIN_AUTOMATON_MAX_DISTANCE));
+        dawgInit(&index->dawg, index->words, index->lengths, index->size);
+        index->automatonDistance = maxDistance;
+    }
+}
+
+/**
+ * Finds the words of the index closest to the given word, sorted by
+ * distance, then by frequency, most frequent first, then alphabetically.
+ * Only words at most SUGGEST_MAX_DISTANCE away are found. Every thread
+ * keeps a bounded heap of its best words for the partitions it scans;
+ * the heaps are merged into one in the suggestions array, which is then
+ * sorted. Nothing is allocated per word. With SUGGEST_DELETES or
+ * SUGGEST_AUTOMATON the words within a small distance are looked for
+ * first, and with SUGGEST_BK_TREE or SUGGEST_DAWG the index's BkTree or
+ * Dawg is searched instead of the batch; see suggestionIndexUseMethod.
+ *
+ * Neither the index nor its map is changed; everything a query needs is
+ * on the caller's stack, in its engine, allocated by the query itself or,
+ * while it holds them, in the pool's workers. Any number of threads can
+ * ask queries at once: the first gets the pool's helpers and the others
+ * scan alone until it is free again.
+ * @param index
+ * @param engine Scratch memory of the calling thread.
+ * @param word
+ * @param suggestions Filled with the closest words.
+ * @param numSuggestions Number of words wanted, 1 to
+ *        SUGGEST_MAX_SUGGESTIONS.
+ * @return Number of words found, at most numSuggestions.
+ */
+int suggestionIndexFind(SuggestionIndex* index, EditDistance* engine,
+                        const char* word, Suggestion* suggestions,
+                        int numSuggestions)
+{
+    assert(index);
+    assert(engine);
+    assert(word);
+    assert(numSuggestions >= 1 && numSuggestions <= SUGGEST_MAX_SUGGESTIONS);
+
+    SuggestQuery query;
+    SuggestWorker single;
+    SuggestWorker* workers = &single;
+    int numWorkers = 1;
+    SuggestPool* pool = index->pool;
+
+    query.index = index;
+    query.numSuggestions = numSuggestions;
+    editDistancePatternInit(&query.pattern, word, strlen(word));
+    query.nextUp = 0;
+    while (query.nextUp < index->numPartitions
+           && index->batch.groups[index->partitions[query.nextUp]].length
+              < query.pattern.length)
+    {
+        query.nextUp++;
+    }
+    query.nextDown = query.nextUp - 1;
+
+    memset(&single, 0, sizeof(single));
+    single.query = &query;
+    single.engine = engine;
+    single.best = suggestions;
+    single.capacity = numSuggestions;
+    if (index->method == SUGGEST_DELETES)
+    {
+        // every word within the index's distance is found, so when that
+        // fills the heap no word further away can belong in it
+        deleteIndexFind(&index->deletes, engine, &query.pattern,
+                        SUGGEST_MAX_DISTANCE, suggestVisit, &single);
+        if (single.count == numSuggestions)
+        {
+            suggestHeapSort(suggestions, single.count);
+            return single.count;
+        }
+    }
+    else if (index->method == SUGGEST_BK_TREE)
+    {
+        bkTreeFind(&index->bkTree, engine, &query.pattern,
+                   SUGGEST_MAX_DISTANCE, suggestVisit, &single);
+        suggestHeapSort(suggestions, single.count);
+        return single.count;
+    }
+    else if (index->method == SUGGEST_DAWG)
+    {
+        dawgFindNear(&index->dawg, &query.pattern, SUGGEST_MAX_DISTANCE,
+                     suggestVisit, &single);
+        suggestHeapSort(suggestions, single.count);
+        return single.count;
+    }
+    else if (index->method == SUGGEST_AUTOMATON)
+    {
+        // like the delete index, a full heap here is the answer
+        LevenshteinAutomaton automaton;
+        SuggestDeepening deepening;
+        levenshteinAutomatonInit(&automaton, word, query.pattern.length,
+                                 index->automatonDistance);
+        levenshteinAutomatonFind(&automaton, &index->dawg,
+                                 SUGGEST_MAX_DISTANCE, suggestVisit, &single);
+        levenshteinAutomatonCleanUp(&automaton);
+
+        // otherwise every word within the distance is in the heap, so walk
+        // the DAWG one distance further each time until the heap fills; a
+        // small cutoff prunes far more than the open one of SUGGEST_DAWG.
+        // No word is further than the longer of it and the query.
+        int farthest = index->dawg.maxLength > query.pattern.length
+                       ? index->dawg.maxLength : query.pattern.length;
+        deepening.worker = &single;
+        deepening.cutoff = index->automatonDistance;
+        while (single.count < numSuggestions && deepening.cutoff < farthest)
+        {
+            single.count = 0;
+            deepening.cutoff++;
+            dawgFindNear(&index->dawg, &query.pattern, deepening.cutoff,
+                         suggestDeepeningVisit, &deepening);
+        }
+        suggestHeapSort(suggestions, single.count);
+        return single.count;
+    }
+
+    if (!pool || pthread_mutex_trylock(&pool->busy) != 0)
+    {
+        suggestWorkerRun(&single);
+        suggestHeapSort(suggestions, single.count);
+        return single.count;
+    }
+
+    // wake the helpers, scan alongside them, then wait for the rest
+    pthread_mutex_lock(&pool->lock);
+    pool->query = &query;
+    pool->workers[0].query = &query;
+    pool->workers[0].engine = engine;
+    pool->running = pool->numThreads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    suggestWorkerRun(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0)
+    {
+        pthread_cond_wait(&pool->finished, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    workers = pool->workers;
+    numWorkers = pool->numThreads;
+
+    // merge the workers' heaps into one
+    int count = 0;
+    for (int w = 0; w < numWorkers; w++)
+    {
+        for (int i = 0; i < workers[w].count; i++)
+        {
+            suggestHeapOffer(suggestions, &count, numSuggestions,
+                             &workers[w].best[i]);
+        }
+    }
+    suggestHeapSort(suggestions, count);
+    pool->workers[0].engine = &pool->workers[0].ownEngine;
+    pthread_mutex_unlock(&pool->busy);
+    return count;
+}
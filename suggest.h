@@ -0,0 +1,94 @@
+#ifndef SUGGEST_H
+#define SUGGEST_H
+
+/*
+ * CS 261 Data Structures
+ * Assignment 5
+ */
+
+#include "hashMap.h"
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+#include "deleteIndex.h"
+#include "bkTree.h"
+#include "dawg.h"
+#include "levenshteinAutomaton.h"
+
+// Most threads a suggestion index scans with.
+#define SUGGEST_MAX_THREADS 64
+// Partitions per thread, so threads that finish early can take more.
+#define SUGGEST_PARTITIONS_PER_THREAD 4
+// Most suggestions one query can ask for.
+#define SUGGEST_MAX_SUGGESTIONS 50
+
+typedef struct Suggestion Suggestion;
+typedef struct SuggestionIndex SuggestionIndex;
+typedef struct SuggestPool SuggestPool;
+
+typedef enum
+{
+    // Measure every word, on the index's threads.
+    SUGGEST_SCAN,
+    // Look the query's variants up in a DeleteIndex, scanning only when
+    // too few words are close enough.
+    SUGGEST_DELETES,
+    // Search a BkTree of the words.
+    SUGGEST_BK_TREE,
+    // Walk a Dawg of the words.
+    SUGGEST_DAWG,
+    // Run a LevenshteinAutomaton of the query over a Dawg of the words,
+    // walking the Dawg when too few words are close enough.
+    SUGGEST_AUTOMATON
+} SuggestMethod;
+
+/*
+ * A dictionary word close to a query.
+ */
+struct Suggestion
+{
+    // Index of the word in its SuggestionIndex.
+    int index;
+    int distance;
+};
+
+/*
+ * The words of a map laid out for finding the closest ones to a query.
+ * The index points at the map's keys, so the map must not change while
+ * the index is in use; queries only read both.
+ */
+struct SuggestionIndex
+{
+    EditDistanceBatch batch;
+    const char** words;
+    int* lengths;
+    // Frequency of each word. The words are sorted by it, most frequent
+    // first, then alphabetically, which is how ties are broken.
+    int* frequencies;
+    int size;
+    // Each partition is a range of batch groups of one length, ending
+    // where the next one starts; the last ends at the batch's last group.
+    int* partitions;
+    int numPartitions;
+    // Threads that help the calling thread scan, NULL if it scans alone.
+    SuggestPool* pool;
+    SuggestMethod method;
+    // Built while the method is SUGGEST_DELETES.
+    DeleteIndex deletes;
+    // Built while the method is SUGGEST_BK_TREE.
+    BkTree bkTree;
+    // Built while the method is SUGGEST_DAWG or SUGGEST_AUTOMATON.
+    Dawg dawg;
+    // Distance SUGGEST_AUTOMATON builds each query's automaton for.
+    int automatonDistance;
+};
+
+SuggestionIndex* suggestionIndexNew(HashMap* map);
+void suggestionIndexDelete(SuggestionIndex* index);
+void suggestionIndexSetThreads(SuggestionIndex* index, int numThreads);
+void suggestionIndexUseMethod(SuggestionIndex* index, SuggestMethod method,
+                              int maxDistance);
+int suggestionIndexFind(SuggestionIndex* index, EditDistance* engine,
+                        const char* word, Suggestion* suggestions,
+                        int numSuggestions);
+
+#endif
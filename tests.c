@@ -5,10 +5,20 @@
 
 #include "CuTest.h"
 #include "hashMap.h"
+#include "dictionary.h"
+#include "editDistance.h"
+#include "editDistanceBatch.h"
+#include "deleteIndex.h"
+#include "bkTree.h"
+#include "dawg.h"
+#include "levenshteinAutomaton.h"
+#include "suggest.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
 // --- Test Helpers ---
 
@@ -73,6 +83,14 @@ void histAdd(Histogram* hist, char* key)
 void histFromTable(Histogram* hist, HashMap* map)
 {
     histInit(hist);
+    if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        for (int i = 0; i < map->size; i++)
+        {
+            histAdd(hist, map->entries[i].key);
+        }
+        return;
+    }
     for (int i = 0; i < map->capacity; i++)
     {
         HashLink* link = map->table[i];
@@ -84,6 +102,20 @@ void histFromTable(Histogram* hist, HashMap* map)
     }
 }
 
+/**
+ * Returns 1 if the bucket (or slot) at the index holds no links.
+ * @param map
+ * @param index
+ */
+int bucketIsEmpty(HashMap* map, int index)
+{
+    if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+    {
+        return map->slots[index].entry == HASH_SLOT_EMPTY;
+    }
+    return map->table[index] == NULL;
+}
+
 /**
  * Asserts that each key is unique (count is 1 for each key).
  * @param test
@@ -118,11 +150,12 @@ void assertHistCounts(CuTest* test, Histogram* hist)
  * @param numLinks The number of key-value pairs to be added and removed.
  * @param numNotKeys The number of keys not in the table.
  * @param numBuckets The initial number of buckets (capacity) in the table.
+ * @param backend The storage backend of the table.
  */
 void testCase(CuTest* test, HashLink* links, const char** notKeys, int numLinks,
-              int numNotKeys, int numBuckets)
+              int numNotKeys, int numBuckets, HashMapBackend backend)
 {
-    HashMap* map = hashMapNew(numBuckets);
+    HashMap* map = hashMapNewBackend(numBuckets, backend);
     Histogram hist;
     
     // Add links
@@ -145,7 +178,7 @@ void testCase(CuTest* test, HashLink* links, const char** notKeys, int numLinks,
     int sum = 0;
     for (int i = 0; i < map->capacity; i++)
     {
-        if (map->table[i] == NULL)
+        if (bucketIsEmpty(map, i))
         {
             sum++;
         }
@@ -238,7 +271,7 @@ void testSingleUnder(CuTest* test)
         { .key = "g", .value = 4, .next = NULL }
     };
     const char* notKeys[] = { "b", "e", "h" };
-    testCase(test, links, notKeys, 5, 3, 10);
+    testCase(test, links, notKeys, 5, 3, 10, HASH_MAP_CHAINED);
 }
 
 /**
@@ -257,7 +290,7 @@ void testSingleOver(CuTest* test)
         { .key = "g", .value = 4, .next = NULL }
     };
     const char* notKeys[] = { "b", "e", "h" };
-    testCase(test, links, notKeys, 5, 3, 1);
+    testCase(test, links, notKeys, 5, 3, 1, HASH_MAP_CHAINED);
 }
 
 /**
@@ -276,7 +309,7 @@ void testMultipleUnder(CuTest* test)
         { .key = "gh", .value = 4, .next = NULL }
     };
     const char* notKeys[] = { "b", "e", "hg" };
-    testCase(test, links, notKeys, 5, 3, 10);
+    testCase(test, links, notKeys, 5, 3, 10, HASH_MAP_CHAINED);
 }
 
 /**
@@ -295,7 +328,57 @@ void testMultipleOver(CuTest* test)
         { .key = "gh", .value = 4, .next = NULL }
     };
     const char* notKeys[] = { "b", "e", "hg" };
-    testCase(test, links, notKeys, 5, 3, 1);
+    testCase(test, links, notKeys, 5, 3, 1, HASH_MAP_CHAINED);
+}
+
+/**
+ * Tests hash map functions for open addressing tables, with and without
+ * colliding keys and hitting the table load threshold.
+ * @param test
+ */
+void testOpenAddressing(CuTest* test)
+{
+    printf("\n--- Testing open addressing ---\n");
+    HashLink links[] = {
+        { .key = "ab", .value = 0, .next = NULL },
+        { .key = "c", .value = 1, .next = NULL },
+        { .key = "ba", .value = 2, .next = NULL },
+        { .key = "f", .value = 3, .next = NULL },
+        { .key = "gh", .value = 4, .next = NULL }
+    };
+    const char* notKeys[] = { "b", "e", "hg" };
+    testCase(test, links, notKeys, 5, 3, 16, HASH_MAP_OPEN_ADDRESSING);
+    testCase(test, links, notKeys, 5, 3, 1, HASH_MAP_OPEN_ADDRESSING);
+    
+    // The character sum hash puts anagrams in one probe run, so removing
+    // from the middle of it has to keep the rest of the run reachable.
+    HashMap* map = hashMapNewBackend(64, HASH_MAP_OPEN_ADDRESSING);
+    hashMapSetHashFunction(map, hashFunction1);
+    const char* keys[] = { "abc", "acb", "bac", "bca", "cab", "cba", "abd" };
+    int numKeys = 7;
+    for (int i = 0; i < numKeys; i++)
+    {
+        hashMapPut(map, keys[i], i);
+    }
+    for (int i = 0; i < numKeys; i += 2)
+    {
+        hashMapRemove(map, keys[i]);
+    }
+    CuAssertIntEquals(test, numKeys / 2, hashMapSize(map));
+    for (int i = 0; i < numKeys; i++)
+    {
+        int* value = hashMapGet(map, keys[i]);
+        if (i % 2 == 0)
+        {
+            CuAssertPtrEquals(test, NULL, value);
+        }
+        else
+        {
+            CuAssertPtrNotNull(test, value);
+            CuAssertIntEquals(test, i, *value);
+        }
+    }
+    hashMapDelete(map);
 }
 
 /**
@@ -340,6 +423,2107 @@ void testValueUpdate(CuTest* test)
     hashMapDelete(map);
 }
 
+/**
+ * Adds every line of the file to the map as a key with value 0.
+ * @param map
+ * @param path
+ * @return Number of lines read or -1 if the file could not be opened.
+ */
+int loadWordFile(HashMap* map, const char* path)
+{
+    char line[256];
+    int count = 0;
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0')
+        {
+            hashMapPut(map, line, 0);
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * Prints a histogram of chain lengths in the table, grouping lengths above
+ * four into power of two ranges.
+ * @param map
+ * @param label Name to print above the histogram.
+ * @return Length of the longest chain.
+ */
+int printChainHistogram(HashMap* map, const char* label)
+{
+    const int numBins = 10;
+    const char* binNames[] = { "0", "1", "2", "3", "4", "5-8", "9-16",
+                               "17-32", "33-64", "65+" };
+    int bins[10] = { 0 };
+    int longest = 0;
+    for (int i = 0; i < map->capacity; i++)
+    {
+        int length = 0;
+        for (HashLink* link = map->table[i]; link != NULL; link = link->next)
+        {
+            length++;
+        }
+        if (length > longest)
+        {
+            longest = length;
+        }
+        int bin = length;
+        if (length > 4)
+        {
+            bin = 5;
+            for (int limit = 8; length > limit && bin < numBins - 1; limit *= 2)
+            {
+                bin++;
+            }
+        }
+        bins[bin]++;
+    }
+    printf("\n%s: %d links, %d buckets, longest chain %d\n", label,
+           hashMapSize(map), hashMapCapacity(map), longest);
+    for (int i = 0; i < numBins; i++)
+    {
+        printf("  %6s | %d\n", binNames[i], bins[i]);
+    }
+    return longest;
+}
+
+/**
+ * Loads dictionary.txt with the old character sum hash and with the newer
+ * hash functions, printing the chain length distribution of each. The
+ * newer functions should keep every chain short.
+ * @param test
+ */
+void testHashDistribution(CuTest* test)
+{
+    printf("\n--- Testing hash distribution on dictionary.txt ---\n");
+    const char* names[] = { "sum", "fnv1a", "murmur3" };
+    int longest[3];
+    for (int i = 0; i < 3; i++)
+    {
+        HashMap* map = hashMapNew(1000);
+        hashMapSetHashFunction(map, hashFunctionByName(names[i]));
+        int count = loadWordFile(map, "dictionary.txt");
+        CuAssertTrue(test, count > 0);
+        CuAssertIntEquals(test, count, hashMapSize(map));
+        longest[i] = printChainHistogram(map, names[i]);
+        hashMapDelete(map);
+    }
+    CuAssertTrue(test, longest[1] < longest[0]);
+    CuAssertTrue(test, longest[2] < longest[0]);
+    CuAssertTrue(test, longest[1] <= 16);
+    CuAssertTrue(test, longest[2] <= 16);
+}
+
+/**
+ * Loads dictionary.txt into an open addressing table, removes every third
+ * word and checks that exactly the remaining words can still be found.
+ * @param test
+ */
+void testOpenAddressingDictionary(CuTest* test)
+{
+    printf("\n--- Testing open addressing on dictionary.txt ---\n");
+    HashMap* words = hashMapNew(1000);
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(words, "dictionary.txt") > 0);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    CuAssertIntEquals(test, hashMapSize(words), hashMapSize(map));
+    
+    int index = 0;
+    int removed = 0;
+    for (int i = 0; i < words->capacity; i++)
+    {
+        for (HashLink* link = words->table[i]; link != NULL; link = link->next)
+        {
+            if (index++ % 3 == 0)
+            {
+                hashMapRemove(map, link->key);
+                removed++;
+            }
+        }
+    }
+    CuAssertIntEquals(test, hashMapSize(words) - removed, hashMapSize(map));
+    
+    index = 0;
+    for (int i = 0; i < words->capacity; i++)
+    {
+        for (HashLink* link = words->table[i]; link != NULL; link = link->next)
+        {
+            CuAssertIntEquals(test, index++ % 3 != 0,
+                              hashMapContainsKey(map, link->key));
+        }
+    }
+    hashMapDelete(words);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that switching hash functions keeps every link reachable and that
+ * the functions can be looked up by name.
+ * @param test
+ */
+void testSetHashFunction(CuTest* test)
+{
+    printf("\n--- Testing hash function switching ---\n");
+    const char* keys[] = { "ab", "ba", "c", "gh", "hg", "abc", "cab" };
+    int numKeys = 7;
+    HashMap* map = hashMapNew(3);
+    for (int i = 0; i < numKeys; i++)
+    {
+        hashMapPut(map, keys[i], i);
+    }
+    hashMapSetHashFunction(map, hashFunction1);
+    hashMapSetHashFunction(map, hashFunctionMurmur3);
+    CuAssertIntEquals(test, numKeys, hashMapSize(map));
+    for (int i = 0; i < numKeys; i++)
+    {
+        int* value = hashMapGet(map, keys[i]);
+        CuAssertPtrNotNull(test, value);
+        CuAssertIntEquals(test, i, *value);
+    }
+    hashMapDelete(map);
+    
+    CuAssertPtrEquals(test, (void*)hashFunctionFnv1a,
+                      (void*)hashFunctionByName("fnv1a"));
+    CuAssertPtrEquals(test, NULL, (void*)hashFunctionByName("nope"));
+    CuAssertStrEquals(test, "sum", hashFunctionName(hashFunction1));
+}
+
+/**
+ * Tests that find-or-insert adds missing keys with the given value and
+ * returns the existing value of keys already in the table, for both
+ * backends and across table resizes.
+ * @param test
+ */
+void testFindOrInsert(CuTest* test)
+{
+    printf("\n--- Testing find-or-insert ---\n");
+    const char* keys[] = { "ab", "c", "ba", "f", "gh", "hg" };
+    int numKeys = 6;
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(1, backends[b]);
+        for (int i = 0; i < numKeys; i++)
+        {
+            int* value = hashMapFindOrInsert(map, keys[i], i);
+            CuAssertPtrNotNull(test, value);
+            CuAssertIntEquals(test, i, *value);
+            *value += 10;
+        }
+        CuAssertIntEquals(test, numKeys, hashMapSize(map));
+        for (int i = 0; i < numKeys; i++)
+        {
+            int* value = hashMapFindOrInsert(map, keys[i], -1);
+            CuAssertIntEquals(test, i + 10, *value);
+            CuAssertPtrEquals(test, hashMapGet(map, keys[i]), value);
+        }
+        CuAssertIntEquals(test, numKeys, hashMapSize(map));
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * Tests that growing a chained table moves the existing links instead of
+ * copying them, so a link's value keeps its address through resizes.
+ * @param test
+ */
+void testResizeRelinks(CuTest* test)
+{
+    printf("\n--- Testing resize relinking ---\n");
+    char key[16];
+    HashMap* map = hashMapNew(1);
+    hashMapPut(map, "first", 7);
+    int* value = hashMapGet(map, "first");
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key%d", i);
+        hashMapPut(map, key, i);
+    }
+    CuAssertTrue(test, hashMapCapacity(map) >= 1000);
+    CuAssertPtrEquals(test, value, hashMapGet(map, "first"));
+    CuAssertIntEquals(test, 7, *value);
+    for (int i = 0; i < 1000; i++)
+    {
+        sprintf(key, "key%d", i);
+        CuAssertIntEquals(test, i, *hashMapGet(map, key));
+    }
+    CuAssertIntEquals(test, 1001, hashMapSize(map));
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that a table reserved for a number of links holds that many
+ * without resizing, for both backends.
+ * @param test
+ */
+void testReserve(CuTest* test)
+{
+    printf("\n--- Testing reserve ---\n");
+    char key[16];
+    int numKeys = 5000;
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(10, backends[b]);
+        hashMapPut(map, "before", 1);
+        hashMapReserve(map, numKeys);
+        int capacity = hashMapCapacity(map);
+        CuAssertIntEquals(test, 1, *hashMapGet(map, "before"));
+        for (int i = 1; i < numKeys; i++)
+        {
+            sprintf(key, "key%d", i);
+            hashMapPut(map, key, i);
+        }
+        CuAssertIntEquals(test, numKeys, hashMapSize(map));
+        CuAssertIntEquals(test, capacity, hashMapCapacity(map));
+        
+        // Reserving less than the current capacity changes nothing.
+        hashMapReserve(map, 10);
+        CuAssertIntEquals(test, capacity, hashMapCapacity(map));
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * Tests that keys inserted as borrowed are stored by pointer, can live in a
+ * buffer owned by the map, and are found like copied keys.
+ * @param test
+ */
+void testBorrowedKeys(CuTest* test)
+{
+    printf("\n--- Testing borrowed keys ---\n");
+    const char words[] = "ab\0c\0ba\0f\0gh";
+    int offsets[] = { 0, 3, 5, 8, 10 };
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(1, backends[b]);
+        char* buffer = hashMapKeyBuffer(map, sizeof(words));
+        memcpy(buffer, words, sizeof(words));
+        for (int i = 0; i < 5; i++)
+        {
+            hashMapFindOrInsertBorrowed(map, buffer + offsets[i], i);
+        }
+        hashMapPut(map, "copied", 5);
+        CuAssertIntEquals(test, 6, hashMapSize(map));
+        
+        // Every borrowed key is stored as the pointer into the buffer.
+        int borrowed = 0;
+        for (int i = 0; i < map->capacity; i++)
+        {
+            if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+            {
+                char* key = i < map->size ? map->entries[i].key : NULL;
+                borrowed += key != NULL && key >= buffer
+                            && key < buffer + sizeof(words);
+                continue;
+            }
+            for (HashLink* link = map->table[i]; link != NULL; link = link->next)
+            {
+                borrowed += link->key >= buffer
+                            && link->key < buffer + sizeof(words);
+            }
+        }
+        CuAssertIntEquals(test, 5, borrowed);
+        CuAssertIntEquals(test, 3, *hashMapGet(map, "f"));
+        CuAssertIntEquals(test, 5, *hashMapGet(map, "copied"));
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * Returns the link holding the key in a chained map.
+ * @param map
+ * @param key
+ * @return The link, or NULL if the key is not in the map.
+ */
+HashLink* findLink(HashMap* map, const char* key)
+{
+    for (int i = 0; i < map->capacity; i++)
+    {
+        for (HashLink* link = map->table[i]; link != NULL; link = link->next)
+        {
+            if (strcmp(link->key, key) == 0)
+            {
+                return link;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Tests that links released by removing keys are reused before the arena
+ * is grown, and that key buffers are kept apart from the arena's blocks
+ * even when one is the first thing a map allocates.
+ * @param test
+ */
+void testArena(CuTest* test)
+{
+    printf("\n--- Testing arena ---\n");
+    char key[16];
+    HashMap* map = hashMapNew(1000);
+    for (int i = 0; i < 100; i++)
+    {
+        sprintf(key, "key%d", i);
+        hashMapPut(map, key, i);
+    }
+    HashLink* removed[2] = { findLink(map, "key3"), findLink(map, "key40") };
+    hashMapRemove(map, "key3");
+    hashMapRemove(map, "key40");
+    CuAssertPtrEquals(test, removed[1], map->freeLinks);
+    CuAssertPtrEquals(test, removed[0], map->freeLinks->next);
+    
+    HashArenaBlock* block = map->arena;
+    size_t used = block->used;
+    hashMapPut(map, "new", 1);
+    hashMapPut(map, "newer", 2);
+    CuAssertPtrEquals(test, NULL, map->freeLinks);
+    CuAssertPtrEquals(test, removed[1], findLink(map, "new"));
+    CuAssertPtrEquals(test, removed[0], findLink(map, "newer"));
+    // Only the two key copies came out of the arena.
+    CuAssertPtrEquals(test, block, map->arena);
+    CuAssertIntEquals(test, used + sizeof("new") + sizeof("newer"),
+                      map->arena->used);
+    CuAssertIntEquals(test, 99, *hashMapGet(map, "key99"));
+    CuAssertIntEquals(test, 0, hashMapContainsKey(map, "key3"));
+    hashMapDelete(map);
+    
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        map = hashMapNewBackend(1, backends[b]);
+        size_t size = 3 * ARENA_BLOCK_SIZE;
+        char* buffer = hashMapKeyBuffer(map, size);
+        CuAssertPtrEquals(test, NULL, map->arena);
+        for (size_t i = 0; i + 8 <= size; i += 8)
+        {
+            sprintf(buffer + i, "b%06d", (int)(i / 8));
+            hashMapFindOrInsertBorrowed(map, buffer + i, (int)(i / 8));
+        }
+        hashMapPut(map, "copied", -1);
+        
+        // The arena starts at its first block size, whatever the buffer's.
+        CuAssertPtrNotNull(test, map->arena);
+        for (block = map->arena; block->next != NULL; block = block->next)
+        {
+            CuAssertTrue(test, buffer != block->data);
+        }
+        CuAssertTrue(test, buffer != block->data);
+        CuAssertIntEquals(test, ARENA_BLOCK_SIZE, block->size);
+        CuAssertPtrEquals(test, buffer, map->keyBuffers->data);
+        CuAssertPtrEquals(test, NULL, map->keyBuffers->next);
+        CuAssertIntEquals(test, (int)(size / 8) + 1, hashMapSize(map));
+        CuAssertIntEquals(test, 1234, *hashMapGet(map, "b001234"));
+        CuAssertIntEquals(test, -1, *hashMapGet(map, "copied"));
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * Tests that a saved map loads back with the same hash function, layout,
+ * keys and values for both backends, read in place, that it saves back
+ * unchanged and can still grow, that resized files are rejected and that
+ * hashMapVerify finds damaged ones.
+ * @param test
+ */
+void testSaveLoad(CuTest* test)
+{
+    printf("\n--- Testing save and load ---\n");
+    char key[16];
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(1, backends[b]);
+        hashMapSetHashFunction(map, hashFunctionMurmur3);
+        for (int i = 0; i < 500; i++)
+        {
+            sprintf(key, "key%d", i);
+            hashMapPut(map, key, i);
+        }
+        hashMapRemove(map, "key7");
+        
+        FILE* file = tmpfile();
+        CuAssertPtrNotNull(test, file);
+        CuAssertIntEquals(test, 1, hashMapSave(map, file));
+        rewind(file);
+        HashMap* loaded = hashMapLoad(file);
+        CuAssertPtrNotNull(test, loaded);
+        CuAssertIntEquals(test, backends[b], loaded->backend);
+        CuAssertIntEquals(test, hashMapSize(map), hashMapSize(loaded));
+        CuAssertIntEquals(test, hashMapCapacity(map), hashMapCapacity(loaded));
+        CuAssertPtrEquals(test, (void*)hashFunctionMurmur3,
+                          (void*)loaded->hashFunction);
+        
+        // Every slot or chain holds the same keys in the same order, the
+        // saved offsets and indexes leading to them.
+        const HashFileEntry* saved = loaded->fileEntries;
+        CuAssertPtrNotNull(test, saved);
+        for (int i = 0; i < map->capacity; i++)
+        {
+            if (map->backend == HASH_MAP_OPEN_ADDRESSING)
+            {
+                CuAssertIntEquals(test, map->slots[i].entry,
+                                  loaded->slots[i].entry);
+                if (i < map->size)
+                {
+                    CuAssertStrEquals(test, map->entries[i].key,
+                                      loaded->fileKeys + saved[i].key);
+                }
+                continue;
+            }
+            HashLink* link = map->table[i];
+            uint32_t next = loaded->fileTable[i];
+            while (link != NULL && next != 0)
+            {
+                CuAssertStrEquals(test, link->key,
+                                  loaded->fileKeys + saved[next - 1].key);
+                link = link->next;
+                next = saved[next - 1].next;
+            }
+            CuAssertTrue(test, link == NULL && next == 0);
+        }
+        for (int i = 0; i < 500; i++)
+        {
+            sprintf(key, "key%d", i);
+            int* value = hashMapGet(loaded, key);
+            if (i == 7)
+            {
+                CuAssertPtrEquals(test, NULL, value);
+                continue;
+            }
+            CuAssertPtrNotNull(test, value);
+            CuAssertIntEquals(test, i, *value);
+        }
+        
+        int visited = 0;
+        HashMapIterator itr;
+        const char* itrKey;
+        int* itrValue;
+        hashMapItrInit(loaded, &itr);
+        while (hashMapItrHasNext(&itr))
+        {
+            hashMapItrNext(&itr, &itrKey, &itrValue);
+            CuAssertPtrEquals(test, hashMapGet(loaded, itrKey), itrValue);
+            visited++;
+        }
+        CuAssertIntEquals(test, 499, visited);
+        
+        // The table is read where the file was loaded, not rebuilt.
+        CuAssertPtrNotNull(test, loaded->image);
+        char* table = backends[b] == HASH_MAP_OPEN_ADDRESSING
+                      ? (char*)loaded->slots : (char*)loaded->fileTable;
+        CuAssertTrue(test, table > loaded->image
+                           && table < loaded->image + loaded->imageBytes);
+        CuAssertPtrEquals(test, NULL, loaded->table);
+        CuAssertPtrEquals(test, NULL, loaded->entries);
+        CuAssertPtrEquals(test, NULL, loaded->arena);
+        CuAssertIntEquals(test, 1, hashMapVerify(loaded));
+        
+        // Saving it again writes the same bytes it was loaded from.
+        FILE* copy = tmpfile();
+        CuAssertIntEquals(test, 1, hashMapSave(loaded, copy));
+        fseek(file, 0, SEEK_END);
+        fseek(copy, 0, SEEK_END);
+        CuAssertIntEquals(test, ftell(file), ftell(copy));
+        rewind(file);
+        rewind(copy);
+        int same = 1;
+        for (int c = fgetc(file); c != EOF; c = fgetc(file))
+        {
+            same &= c == fgetc(copy);
+        }
+        CuAssertIntEquals(test, 1, same);
+        fclose(copy);
+        
+        // A loaded map can still be changed like any other, which copies
+        // it out of the file's memory first.
+        hashMapPut(loaded, "key7", 7);
+        CuAssertPtrEquals(test, NULL, (void*)loaded->fileEntries);
+        hashMapRemove(loaded, "key8");
+        CuAssertIntEquals(test, 7, *hashMapGet(loaded, "key7"));
+        CuAssertIntEquals(test, 0, hashMapContainsKey(loaded, "key8"));
+        for (int i = 500; i < 2000; i++)
+        {
+            sprintf(key, "key%d", i);
+            hashMapPut(loaded, key, i);
+        }
+        hashMapSetHashFunction(loaded, hashFunctionFnv1a);
+        CuAssertIntEquals(test, 1999, hashMapSize(loaded));
+        CuAssertIntEquals(test, 1234, *hashMapGet(loaded, "key1234"));
+        CuAssertIntEquals(test, 9, *hashMapGet(loaded, "key9"));
+        hashMapDelete(loaded);
+        
+        // Copy the saved bytes to check files that differ from them.
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        char* bytes = malloc(length + 1);
+        bytes[length] = '\0';
+        rewind(file);
+        CuAssertIntEquals(test, length, fread(bytes, 1, length, file));
+        
+        // A map saved after other data, where it cannot be mapped, is read
+        // into memory instead.
+        FILE* other = tmpfile();
+        fputc('x', other);
+        fwrite(bytes, 1, length, other);
+        fseek(other, 1, SEEK_SET);
+        loaded = hashMapLoad(other);
+        CuAssertPtrNotNull(test, loaded);
+        CuAssertIntEquals(test, 0, loaded->imageMapped);
+        CuAssertIntEquals(test, 499, hashMapSize(loaded));
+        CuAssertIntEquals(test, 321, *hashMapGet(loaded, "key321"));
+        hashMapDelete(loaded);
+        fclose(other);
+        
+        // Missing or extra bytes do not match the saved sizes.
+        for (long extra = -1; extra <= 1; extra += 2)
+        {
+            other = tmpfile();
+            fwrite(bytes, 1, length + extra, other);
+            rewind(other);
+            CuAssertPtrEquals(test, NULL, hashMapLoad(other));
+            fclose(other);
+        }
+        free(bytes);
+        
+        // A flipped key byte near the end of the file is left to
+        // hashMapVerify, as loading only checks the header and sizes.
+        fseek(file, -3, SEEK_END);
+        fputc('#', file);
+        rewind(file);
+        loaded = hashMapLoad(file);
+        CuAssertPtrNotNull(test, loaded);
+        CuAssertIntEquals(test, 0, hashMapVerify(loaded));
+        hashMapDelete(loaded);
+        fclose(file);
+        
+        // A file from another version is rejected.
+        file = tmpfile();
+        CuAssertIntEquals(test, 1, hashMapSave(map, file));
+        uint32_t version = HASH_MAP_FILE_VERSION + 1;
+        fseek(file, sizeof(uint32_t), SEEK_SET);
+        fwrite(&version, sizeof(version), 1, file);
+        rewind(file);
+        CuAssertPtrEquals(test, NULL, hashMapLoad(file));
+        fclose(file);
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * hashMapForEach visitor that adds the value to a running total and then
+ * doubles it.
+ * @param key
+ * @param value
+ * @param context Pointer to the int total.
+ */
+void sumAndDoubleVisit(const char* key, int* value, void* context)
+{
+    *(int*)context += *value;
+    *value *= 2;
+}
+
+/**
+ * Tests that the iterator and hashMapForEach visit every entry exactly once
+ * with pointers into the map, for both backends.
+ * @param test
+ */
+void testIteration(CuTest* test)
+{
+    printf("\n--- Testing iteration ---\n");
+    char key[16];
+    int numKeys = 300;
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(1, backends[b]);
+        int expected = 0;
+        for (int i = 0; i < numKeys; i++)
+        {
+            sprintf(key, "key%d", i);
+            hashMapPut(map, key, i);
+            expected += i;
+        }
+        
+        // Iterate and bump every value in place.
+        HashMapIterator itr;
+        Histogram hist;
+        const char* itrKey;
+        int* itrValue;
+        int count = 0;
+        histInit(&hist);
+        hashMapItrInit(map, &itr);
+        while (hashMapItrHasNext(&itr))
+        {
+            hashMapItrNext(&itr, &itrKey, &itrValue);
+            CuAssertPtrEquals(test, hashMapGet(map, itrKey), itrValue);
+            histAdd(&hist, (char*)itrKey);
+            (*itrValue)++;
+            count++;
+        }
+        CuAssertIntEquals(test, numKeys, count);
+        CuAssertIntEquals(test, numKeys, hist.size);
+        assertHistCounts(test, &hist);
+        histCleanUp(&hist);
+        
+        // The visitor sees the bumped values and can change them too.
+        int total = 0;
+        hashMapForEach(map, sumAndDoubleVisit, &total);
+        CuAssertIntEquals(test, expected + numKeys, total);
+        CuAssertIntEquals(test, 2 * 8, *hashMapGet(map, "key7"));
+        hashMapDelete(map);
+    }
+    
+    // An empty map has nothing to visit.
+    HashMap* map = hashMapNew(4);
+    HashMapIterator itr;
+    hashMapItrInit(map, &itr);
+    CuAssertIntEquals(test, 0, hashMapItrHasNext(&itr));
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that removing from an open addressing map keeps its entries dense
+ * and every slot pointing at the entry with its key.
+ * @param test
+ */
+void testDenseEntries(CuTest* test)
+{
+    printf("\n--- Testing dense entries ---\n");
+    char key[16];
+    int numKeys = 200;
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    for (int i = 0; i < numKeys; i++)
+    {
+        sprintf(key, "key%d", i);
+        hashMapPut(map, key, i);
+    }
+    
+    // Remove every third key, including the first and the last entries.
+    for (int i = 0; i < numKeys; i += 3)
+    {
+        sprintf(key, "key%d", i);
+        hashMapRemove(map, key);
+    }
+    sprintf(key, "key%d", numKeys - 1);
+    hashMapRemove(map, key);
+    
+    int filled = 0;
+    for (int i = 0; i < map->capacity; i++)
+    {
+        int entry = map->slots[i].entry;
+        if (entry != HASH_SLOT_EMPTY)
+        {
+            CuAssertTrue(test, entry >= 0 && entry < map->size);
+            CuAssertIntEquals(test, map->entries[entry].hash,
+                              map->slots[i].hash);
+            filled++;
+        }
+    }
+    CuAssertIntEquals(test, map->size, filled);
+    for (int i = 0; i < numKeys; i++)
+    {
+        sprintf(key, "key%d", i);
+        int* value = hashMapGet(map, key);
+        if (i % 3 == 0 || i == numKeys - 1)
+        {
+            CuAssertPtrEquals(test, NULL, value);
+        }
+        else
+        {
+            CuAssertPtrNotNull(test, value);
+            CuAssertIntEquals(test, i, *value);
+        }
+    }
+    hashMapDelete(map);
+}
+
+/**
+ * Creates a temporary file holding the text, positioned at its start.
+ * @param text
+ * @return The file.
+ */
+FILE* textFile(const char* text)
+{
+    FILE* file = tmpfile();
+    assert(file);
+    fputs(text, file);
+    rewind(file);
+    return file;
+}
+
+/**
+ * Reads back everything written to a temporary file.
+ * @param file
+ * @return Allocated string with the file's contents.
+ */
+char* fileText(FILE* file)
+{
+    long length = ftell(file);
+    char* text = malloc(length + 1);
+    assert(text);
+    rewind(file);
+    text[fread(text, 1, length, file)] = '\0';
+    return text;
+}
+
+/**
+ * Tests that checkFile splits words on anything but letters, digits and
+ * apostrophes, numbers their lines and columns from 1 across CRLF line
+ * ends and read blocks, reports a word cut off by the end of the input,
+ * and gives the same records looking words up in a DAWG; and that
+ * checkFiles reads "-" from its input and carries on past files it
+ * cannot open.
+ * @param test
+ */
+void testCheckFile(CuTest* test)
+{
+    printf("\n--- Testing check file ---\n");
+    const char* words[] = { "hello", "world", "don't", "x2y", "last", "a" };
+    int lengths[] = { 5, 5, 5, 3, 4, 1 };
+    HashMap* map = hashMapNewBackend(8, HASH_MAP_OPEN_ADDRESSING);
+    for (int i = 0; i < 6; i++)
+    {
+        hashMapPut(map, words[i], 0);
+    }
+    Dawg dawg;
+    dawgInit(&dawg, words, lengths, 6);
+    const char* input = "Hello, world!\r\n  don't  x2y-z\n\nlast";
+    const char* expected =
+        "in\t1\t1\tHello\tok\n"
+        "in\t1\t8\tworld\tok\n"
+        "in\t2\t3\tdon't\tok\n"
+        "in\t2\t10\tx2y\tok\n"
+        "in\t2\t14\tz\tmisspelled\n"
+        "in\t4\t1\tlast\tok\n";
+    for (int d = 0; d < 2; d++)
+    {
+        FILE* file = textFile(input);
+        FILE* output = tmpfile();
+        CuAssertIntEquals(test, 1, checkFile(file, "in", d ? NULL : map,
+                                             d ? &dawg : NULL, output));
+        char* text = fileText(output);
+        CuAssertStrEquals(test, expected, text);
+        free(text);
+        fclose(file);
+        fclose(output);
+    }
+    
+    // A word split across two read blocks is still one word.
+    char* wide = malloc(BATCH_BLOCK_SIZE + 16);
+    memset(wide, ' ', BATCH_BLOCK_SIZE - 2);
+    strcpy(wide + BATCH_BLOCK_SIZE - 2, "hello there");
+    FILE* file = textFile(wide);
+    FILE* output = tmpfile();
+    CuAssertIntEquals(test, 1, checkFile(file, "in", map, NULL, output));
+    char* text = fileText(output);
+    char line[64];
+    sprintf(line, "in\t1\t%d\thello\tok\nin\t1\t%d\tthere\tmisspelled\n",
+            BATCH_BLOCK_SIZE - 1, BATCH_BLOCK_SIZE + 5);
+    CuAssertStrEquals(test, line, text);
+    free(text);
+    free(wide);
+    fclose(file);
+    fclose(output);
+    
+    file = fopen("checkFiles.tmp", "w");
+    CuAssertPtrNotNull(test, file);
+    fputs("world b", file);
+    fclose(file);
+    const char* names[] = { "-", "checkFiles.tmp", "no/such/file", "-" };
+    file = textFile("a b");
+    output = tmpfile();
+    CuAssertIntEquals(test, 1, checkFiles(map, NULL, 4, names, file, output));
+    text = fileText(output);
+    // The input is used up by the first "-".
+    CuAssertStrEquals(test,
+                      "-\t1\t1\ta\tok\n"
+                      "-\t1\t3\tb\tmisspelled\n"
+                      "checkFiles.tmp\t1\t1\tworld\tok\n"
+                      "checkFiles.tmp\t1\t7\tb\tmisspelled\n", text);
+    free(text);
+    fclose(file);
+    fclose(output);
+    remove("checkFiles.tmp");
+    
+    // With no files the input is checked.
+    file = textFile("last");
+    output = tmpfile();
+    CuAssertIntEquals(test, 0, checkFiles(map, NULL, 0, NULL, file, output));
+    text = fileText(output);
+    CuAssertStrEquals(test, "-\t1\t1\tlast\tok\n", text);
+    free(text);
+    fclose(file);
+    fclose(output);
+    dawgCleanUp(&dawg);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that loadDictionary takes counts after words only when asked to:
+ * after spaces or tabs, before LF or CRLF line ends or the end of the
+ * file, capped at INT_MAX, a word listed twice keeping its larger count.
+ * Without counts every run of word characters, digits included, is a word.
+ * @param test
+ */
+void testLoadDictionary(CuTest* test)
+{
+    printf("\n--- Testing load dictionary ---\n");
+    const char* text = "the 100\r\nof\t20  \r\nthe 7\nbig 99999999999\n"
+                       "abc 123\nzero 0\nx y 5\nend 42";
+    const char* words[] = { "the", "of", "big", "abc", "zero", "x", "y",
+                            "end" };
+    int counts[] = { 100, 20, INT_MAX, 123, 0, 0, 5, 42 };
+    const char* numbers[] = { "100", "20", "7", "99999999999", "123", "0",
+                              "5", "42" };
+    HashMapBackend backends[] = { HASH_MAP_CHAINED, HASH_MAP_OPEN_ADDRESSING };
+    for (int b = 0; b < 2; b++)
+    {
+        HashMap* map = hashMapNewBackend(1, backends[b]);
+        FILE* file = textFile(text);
+        loadDictionary(file, map, 1);
+        fclose(file);
+        CuAssertIntEquals(test, 8, hashMapSize(map));
+        for (int i = 0; i < 8; i++)
+        {
+            int* value = hashMapGet(map, words[i]);
+            CuAssertPtrNotNull(test, value);
+            CuAssertIntEquals(test, counts[i], *value);
+        }
+        hashMapDelete(map);
+        
+        map = hashMapNewBackend(1, backends[b]);
+        file = textFile(text);
+        loadDictionary(file, map, 0);
+        fclose(file);
+        CuAssertIntEquals(test, 16, hashMapSize(map));
+        for (int i = 0; i < 8; i++)
+        {
+            CuAssertIntEquals(test, 0, *hashMapGet(map, words[i]));
+            CuAssertIntEquals(test, 0, *hashMapGet(map, numbers[i]));
+        }
+        hashMapDelete(map);
+    }
+}
+
+/**
+ * Tests that editDistance agrees with levenshtein on short pairs, and on
+ * pairs long enough to need wider cells, while reusing one engine.
+ * @param test
+ */
+void testEditDistance(CuTest* test)
+{
+    printf("\n--- Testing edit distance ---\n");
+    const char* pairs[][2] = {
+        { "", "" }, { "", "abc" }, { "abc", "" }, { "kitten", "sitting" },
+        { "flaw", "lawn" }, { "teh", "the" }, { "same", "same" },
+        { "receive", "recieve" }, { "a", "zzzzzzzz" }
+    };
+    EditDistance engine;
+    editDistanceInit(&engine);
+    for (int i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+    {
+        CuAssertIntEquals(test, levenshtein(pairs[i][0], pairs[i][1]),
+                          editDistance(&engine, pairs[i][0],
+                                       strlen(pairs[i][0]), pairs[i][1],
+                                       strlen(pairs[i][1])));
+    }
+    CuAssertIntEquals(test, 3, editDistance(&engine, "kitten", 6,
+                                            "sitting", 7));
+    
+    // Lengths past 255 and 65535 switch to 16 and 32 bit cells.
+    int lengths[] = { 300, 70000 };
+    for (int i = 0; i < 2; i++)
+    {
+        char* string1 = malloc(lengths[i] + 1);
+        char* string2 = malloc(101);
+        for (int j = 0; j < lengths[i]; j++)
+        {
+            string1[j] = 'a' + j % 7;
+        }
+        string1[lengths[i]] = '\0';
+        for (int j = 0; j < 100; j++)
+        {
+            string2[j] = 'a' + j % 5;
+        }
+        string2[100] = '\0';
+        CuAssertIntEquals(test, levenshtein(string1, string2),
+                          editDistance(&engine, string1, lengths[i],
+                                       string2, 100));
+        CuAssertIntEquals(test, levenshtein(string1, string2),
+                          editDistance(&engine, string2, 100,
+                                       string1, lengths[i]));
+        free(string1);
+        free(string2);
+    }
+    editDistanceCleanUp(&engine);
+}
+
+/**
+ * Tests that editDistanceBounded gives the exact distance up to the cutoff
+ * and cutoff + 1 past it, for every cutoff from 0 up past the distance.
+ * @param test
+ */
+void testBoundedEditDistance(CuTest* test)
+{
+    printf("\n--- Testing bounded edit distance ---\n");
+    const char* words[] = {
+        "", "a", "teh", "the", "then", "kitten", "sitting", "speling",
+        "spelling", "xylophoen", "xylophone", "antidisestablishment",
+        "establishment", "abcdefghijklmnop", "ponmlkjihgfedcba"
+    };
+    int numWords = sizeof(words) / sizeof(words[0]);
+    EditDistance engine;
+    editDistanceInit(&engine);
+    for (int i = 0; i < numWords; i++)
+    {
+        for (int j = 0; j < numWords; j++)
+        {
+            int distance = levenshtein(words[i], words[j]);
+            for (int cutoff = 0; cutoff <= distance + 2; cutoff++)
+            {
+                int expected = distance <= cutoff ? distance : cutoff + 1;
+                CuAssertIntEquals(test, expected,
+                    editDistanceBounded(&engine, words[i], strlen(words[i]),
+                                        words[j], strlen(words[j]), cutoff));
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+}
+
+/*
+ * Query measured against every dictionary word by patternCheckVisit.
+ */
+typedef struct PatternCheck
+{
+    EditDistance engine;
+    EditDistancePattern pattern;
+    int mismatches;
+} PatternCheck;
+
+/**
+ * Counts a mismatch if editDistancePattern disagrees with levenshtein on
+ * the key, either unbounded or with a cutoff of 2.
+ * @param key
+ * @param value
+ * @param context Pointer to the PatternCheck.
+ */
+void patternCheckVisit(const char* key, int* value, void* context)
+{
+    PatternCheck* check = context;
+    int distance = levenshtein(check->pattern.string, key);
+    int length = strlen(key);
+    int bounded = distance <= 2 ? distance : 3;
+    check->mismatches += distance != editDistancePattern(&check->engine,
+                                                         &check->pattern,
+                                                         key, length, 1000);
+    check->mismatches += bounded != editDistancePattern(&check->engine,
+                                                        &check->pattern,
+                                                        key, length, 2);
+}
+
+/**
+ * Tests the bit-parallel kernel against levenshtein over the whole
+ * dictionary, with queries on both sides of the 64 character limit.
+ * @param test
+ */
+void testPatternEditDistance(CuTest* test)
+{
+    printf("\n--- Testing bit-parallel edit distance ---\n");
+    char longQueries[2][80];
+    memset(longQueries[0], 'e', 64);
+    longQueries[0][64] = '\0';
+    strcpy(longQueries[1], "pneumonoultramicroscopicsilicovolcanoconiosis"
+                           "antidisestablishment");
+    const char* queries[] = {
+        "", "e", "teh", "speling", "xylophoen", "antidisestablishmentarianism",
+        longQueries[0], longQueries[1]
+    };
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    
+    PatternCheck check;
+    editDistanceInit(&check.engine);
+    check.mismatches = 0;
+    for (int i = 0; i < sizeof(queries) / sizeof(queries[0]); i++)
+    {
+        editDistancePatternInit(&check.pattern, queries[i],
+                                strlen(queries[i]));
+        hashMapForEach(map, patternCheckVisit, &check);
+    }
+    CuAssertIntEquals(test, 0, check.mismatches);
+    editDistanceCleanUp(&check.engine);
+    hashMapDelete(map);
+}
+
+/*
+ * Words of a map collected by collectVisit, with each word's distance as
+ * reported by a batch scan.
+ */
+typedef struct BatchCheck
+{
+    const char** words;
+    int* lengths;
+    int* reported;
+    int size;
+    int cutoff;
+} BatchCheck;
+
+// Misspellings, and the empty word, that the dictionary's search
+// structures are checked against.
+#define NUM_CHECK_QUERIES 4
+const char* checkQueries[NUM_CHECK_QUERIES] = {
+    "teh", "speling", "xylophoen", ""
+};
+
+/**
+ * Appends the key to the BatchCheck's words.
+ * @param key
+ * @param value
+ * @param context Pointer to the BatchCheck.
+ */
+void collectVisit(const char* key, int* value, void* context)
+{
+    BatchCheck* check = context;
+    check->words[check->size] = key;
+    check->lengths[check->size] = strlen(key);
+    check->size++;
+}
+
+/**
+ * Loads the dictionary into an open addressing map and collects its words
+ * for a BatchCheck, with room to record a distance for each.
+ * @param test
+ * @param map Set to the loaded map, which holds the words and is deleted
+ *        after the check.
+ * @return The allocated check, freed with batchCheckDelete.
+ */
+BatchCheck* batchCheckNew(CuTest* test, HashMap** map)
+{
+    *map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(*map, "dictionary.txt") > 0);
+    BatchCheck* check = malloc(sizeof(BatchCheck));
+    int size = hashMapSize(*map);
+    CuAssertPtrNotNull(test, check);
+    check->words = malloc(sizeof(char*) * size);
+    check->lengths = malloc(sizeof(int) * size);
+    check->reported = malloc(sizeof(int) * size);
+    check->size = 0;
+    check->cutoff = 0;
+    hashMapForEach(*map, collectVisit, check);
+    return check;
+}
+
+/**
+ * Frees a BatchCheck from batchCheckNew.
+ * @param check
+ */
+void batchCheckDelete(BatchCheck* check)
+{
+    free(check->words);
+    free(check->lengths);
+    free(check->reported);
+    free(check);
+}
+
+/**
+ * Records the reported distance, marking words reported twice with -2.
+ * @param index
+ * @param distance
+ * @param context Pointer to the BatchCheck.
+ * @return The BatchCheck's fixed cutoff.
+ */
+int batchCheckVisit(int index, int distance, void* context)
+{
+    BatchCheck* check = context;
+    check->reported[index] = check->reported[index] == -1 ? distance : -2;
+    return check->cutoff;
+}
+
+/**
+ * Tests that every batch kernel the processor supports reports exactly
+ * the dictionary words within the cutoff, with the same distances as
+ * editDistanceBounded, whether the batch is scanned in order or nearest
+ * lengths first, so the character masks never filter out a word within
+ * the cutoff, counted with popcnt or without.
+ * @param test
+ */
+void testBatchEditDistance(CuTest* test)
+{
+    printf("\n--- Testing batch edit distance ---\n");
+    const char* queries[] = {
+        "teh", "speling", "xylophoen", "", "aaaaaa", "a!a",
+        "pneumonoultramicroscopicsilicovolcanoconiosisantidisestablishment"
+    };
+    int cutoffs[] = { 0, 2, 4, 300 };
+    EditBatchKernel kernels[] = {
+        EDIT_BATCH_SCALAR, EDIT_BATCH_SSE2, EDIT_BATCH_AVX2
+    };
+    HashMap* map;
+    BatchCheck* check = batchCheckNew(test, &map);
+    
+    EditDistanceBatch batch;
+    EditDistance engine;
+    EditDistancePattern pattern;
+    editDistanceBatchInit(&batch, check->words, check->lengths, check->size);
+    editDistanceInit(&engine);
+    for (int length = 0; length <= batch.maxLength; length++)
+    {
+        for (int g = batch.lengthGroups[length];
+             g < batch.lengthGroups[length + 1]; g++)
+        {
+            CuAssertIntEquals(test, length, batch.groups[g].length);
+        }
+    }
+    CuAssertIntEquals(test, batch.numGroups,
+                      batch.lengthGroups[batch.maxLength + 1]);
+    for (int i = 0; i < batch.size; i++)
+    {
+        CuAssertTrue(test, batch.masks[i]
+                           == editDistanceCharacters(batch.words[i],
+                                                     batch.lengths[i]));
+    }
+    // 'a' and '!' are 64 apart and share a bit
+    CuAssertTrue(test, editDistanceCharacters("a!a", 3)
+                       == editDistanceCharacters("a", 1));
+    CuAssertTrue(test, editDistanceCharacters("", 0) == 0);
+    int popcnt = batch.popcnt;
+    for (int k = 0; k < 3; k++)
+    {
+        if (!editDistanceBatchUseKernel(&batch, kernels[k]))
+        {
+            printf("kernel %d not supported\n", kernels[k]);
+            continue;
+        }
+        // the SSE2 kernel's masks are counted without popcnt
+        batch.popcnt = popcnt && kernels[k] != EDIT_BATCH_SSE2;
+        for (int q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+        {
+            int length = strlen(queries[q]);
+            editDistancePatternInit(&pattern, queries[q], length);
+            for (int c = 0; c < 8; c++)
+            {
+                // the longest query with the largest cutoff is slow
+                if (length > 64 && cutoffs[c % 4] > 4)
+                {
+                    continue;
+                }
+                int mismatches = 0;
+                check->cutoff = cutoffs[c % 4];
+                memset(check->reported, -1, sizeof(int) * check->size);
+                if (c < 4)
+                {
+                    editDistanceBatchScan(&engine, &batch, &pattern,
+                                          check->cutoff, NULL, batchCheckVisit,
+                                          check);
+                }
+                else
+                {
+                    editDistanceBatchScanNearest(&engine, &batch, &pattern,
+                                                 check->cutoff, NULL,
+                                                 batchCheckVisit, check);
+                }
+                for (int i = 0; i < check->size; i++)
+                {
+                    int distance = editDistanceBounded(&engine, queries[q],
+                                                       length,
+                                                       check->words[i],
+                                                       check->lengths[i],
+                                                       check->cutoff);
+                    int expected = distance <= check->cutoff ? distance : -1;
+                    mismatches += expected != check->reported[i];
+                }
+                CuAssertIntEquals(test, 0, mismatches);
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    editDistanceBatchCleanUp(&batch);
+    batchCheckDelete(check);
+    hashMapDelete(map);
+}
+
+/*
+ * Words reported by editDistanceBatchScanNearest in the order it visited
+ * them, and the smallest distances among them.
+ */
+typedef struct NearestCheck
+{
+    int* reported;
+    int* order;
+    int numVisited;
+    // Smallest distances reported so far, in order.
+    int best[5];
+    int numBest;
+    // 1 to return the largest of best once it is full, as a query's heap
+    // does; 0 to keep the cutoff.
+    int tighten;
+    int cutoff;
+} NearestCheck;
+
+/**
+ * Records the word's distance and place in the visit order, and keeps the
+ * smallest distances.
+ * @param index
+ * @param distance
+ * @param context Pointer to the NearestCheck.
+ * @return The cutoff, lowered to the largest of the smallest distances
+ *         once there are enough of them if the check tightens it.
+ */
+int nearestCheckVisit(int index, int distance, void* context)
+{
+    NearestCheck* check = context;
+    int size = sizeof(check->best) / sizeof(check->best[0]);
+    check->reported[index] = check->reported[index] == -1 ? distance : -2;
+    check->order[check->numVisited++] = index;
+    if (check->numBest < size || distance < check->best[size - 1])
+    {
+        int i = check->numBest < size ? check->numBest++ : size - 1;
+        for (; i > 0 && check->best[i - 1] > distance; i--)
+        {
+            check->best[i] = check->best[i - 1];
+        }
+        check->best[i] = distance;
+    }
+    if (check->tighten && check->numBest == size)
+    {
+        return check->best[size - 1];
+    }
+    return check->cutoff;
+}
+
+/**
+ * Tests that editDistanceBatchScanNearest visits the query's own length
+ * first, with the groups holding its first letter ahead of the rest of
+ * that length, then one shorter, one longer and so on; and that when the
+ * visitor tightens the cutoff the scan stops early without missing a
+ * word closer than the last cutoff, so the closest distances are those
+ * of measuring every word.
+ * @param test
+ */
+void testBatchScanNearest(CuTest* test)
+{
+    printf("\n--- Testing nearest lengths first batch scan ---\n");
+    const char* queries[] = {
+        "teh", "speling", "xylophoen", "qu", "", "zzzzzzzzzzzz",
+        "pneumonoultramicroscopicsilicovolcanoconiosisantidisestablishment"
+    };
+    HashMap* map;
+    BatchCheck* words = batchCheckNew(test, &map);
+
+    NearestCheck check;
+    check.reported = words->reported;
+    check.order = malloc(sizeof(int) * words->size);
+    int* distances = malloc(sizeof(int) * words->size);
+    int size = sizeof(check.best) / sizeof(check.best[0]);
+
+    EditDistanceBatch batch;
+    EditDistance engine;
+    EditDistancePattern pattern;
+    editDistanceBatchInit(&batch, words->words, words->lengths, words->size);
+    editDistanceInit(&engine);
+    for (int q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+    {
+        int length = strlen(queries[q]);
+        editDistancePatternInit(&pattern, queries[q], length);
+        for (int i = 0; i < words->size; i++)
+        {
+            distances[i] = editDistance(&engine, queries[q], length,
+                                        words->words[i], words->lengths[i]);
+        }
+
+        // with a cutoff past every word, each is visited once, in order
+        if (length <= 64)
+        {
+            check.numVisited = 0;
+            check.numBest = 0;
+            check.tighten = 0;
+            check.cutoff = 300;
+            memset(check.reported, -1, sizeof(int) * words->size);
+            editDistanceBatchScanNearest(&engine, &batch, &pattern,
+                                         check.cutoff, NULL,
+                                         nearestCheckVisit, &check);
+            CuAssertIntEquals(test, words->size, check.numVisited);
+            int mismatches = 0;
+            for (int i = 0; i < words->size; i++)
+            {
+                mismatches += check.reported[i] != distances[i];
+            }
+            CuAssertIntEquals(test, 0, mismatches);
+
+            // lengths go L, L - 1, L + 1, L - 2, L + 2...
+            int previous = 0;
+            int outOfOrder = 0;
+            for (int v = 0; v < check.numVisited; v++)
+            {
+                int gap = words->lengths[check.order[v]] - length;
+                int rank = gap < 0 ? -2 * gap - 1 : 2 * gap;
+                outOfOrder += rank < previous;
+                previous = rank;
+            }
+            CuAssertIntEquals(test, 0, outOfOrder);
+
+            // the query's first letter leads its own length, give or take
+            // the other words sharing a group with one starting with it
+            int sameLength = 0;
+            int sameLetter = 0;
+            int lastSameLetter = -1;
+            for (int v = 0; v < check.numVisited; v++)
+            {
+                const char* word = words->words[check.order[v]];
+                if (length > 0 && words->lengths[check.order[v]] == length)
+                {
+                    if (word[0] == queries[q][0])
+                    {
+                        sameLetter++;
+                        lastSameLetter = sameLength;
+                    }
+                    sameLength++;
+                }
+            }
+            CuAssertTrue(test, lastSameLetter
+                               < sameLetter + 2 * (EDIT_BATCH_LANES - 1));
+        }
+
+        // a visitor keeping the closest words ends the scan early
+        check.numVisited = 0;
+        check.numBest = 0;
+        check.tighten = 1;
+        check.cutoff = 300;
+        memset(check.reported, -1, sizeof(int) * words->size);
+        int cutoff = editDistanceBatchScanNearest(&engine, &batch, &pattern,
+                                                  check.cutoff, NULL,
+                                                  nearestCheckVisit, &check);
+        CuAssertIntEquals(test, size, check.numBest);
+        CuAssertIntEquals(test, check.best[size - 1], cutoff);
+        CuAssertTrue(test, check.numVisited < words->size);
+        int missed = 0;
+        int closer = 0;
+        for (int i = 0; i < words->size; i++)
+        {
+            if (distances[i] < cutoff)
+            {
+                missed += check.reported[i] != distances[i];
+                closer++;
+            }
+        }
+        CuAssertIntEquals(test, 0, missed);
+        CuAssertTrue(test, closer < size);
+        for (int b = 0; b < size; b++)
+        {
+            // the b-th distance found is the b-th smallest of all
+            int below = 0;
+            int atMost = 0;
+            for (int i = 0; i < words->size; i++)
+            {
+                below += distances[i] < check.best[b];
+                atMost += distances[i] <= check.best[b];
+            }
+            CuAssertTrue(test, below <= b && atMost > b);
+        }
+    }
+    editDistanceCleanUp(&engine);
+    editDistanceBatchCleanUp(&batch);
+    batchCheckDelete(words);
+    free(check.order);
+    free(distances);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that a delete index reports exactly the words within the cutoff,
+ * capped at its distance, with the same distances as editDistanceBounded,
+ * and that suggestions found with one match the scan's.
+ * @param test
+ */
+void testDeleteIndex(CuTest* test)
+{
+    printf("\n--- Testing delete index ---\n");
+    const char* words[] = {
+        "", "a", "aab", "abab", "aaaa", "banana", "bandana", "cabana", "b"
+    };
+    int lengths[9];
+    int reported[9];
+    const char* queries[] = { "", "aaa", "bnaana", "anana", "xyz", "ba" };
+    BatchCheck check;
+    EditDistance engine;
+    EditDistancePattern pattern;
+    DeleteIndex index;
+    editDistanceInit(&engine);
+    
+    for (int i = 0; i < 9; i++)
+    {
+        lengths[i] = strlen(words[i]);
+    }
+    check.words = words;
+    check.lengths = lengths;
+    check.reported = reported;
+    check.size = 9;
+    for (int d = 1; d <= DELETE_INDEX_MAX_DISTANCE; d++)
+    {
+        deleteIndexInit(&index, words, lengths, 9, d);
+        for (int q = 0; q < 6; q++)
+        {
+            int length = strlen(queries[q]);
+            editDistancePatternInit(&pattern, queries[q], length);
+            for (int cutoff = 0; cutoff <= d + 1; cutoff++)
+            {
+                int mismatches = 0;
+                int limit = cutoff < d ? cutoff : d;
+                check.cutoff = cutoff;
+                memset(reported, -1, sizeof(reported));
+                deleteIndexFind(&index, &engine, &pattern, cutoff,
+                                batchCheckVisit, &check);
+                for (int i = 0; i < 9; i++)
+                {
+                    int distance = editDistanceBounded(&engine, queries[q],
+                                                       length, words[i],
+                                                       lengths[i], limit);
+                    int expected = distance <= limit ? distance : -1;
+                    mismatches += expected != reported[i];
+                }
+                CuAssertIntEquals(test, 0, mismatches);
+            }
+        }
+        deleteIndexCleanUp(&index);
+    }
+    editDistanceCleanUp(&engine);
+    
+    const char* misspellings[] = { "teh", "speling", "xylophoen", "recieve" };
+    int counts[] = { 1, 5, SUGGEST_MAX_SUGGESTIONS };
+    Suggestion scanned[4][3][SUGGEST_MAX_SUGGESTIONS];
+    int numScanned[4][3];
+    Suggestion found[SUGGEST_MAX_SUGGESTIONS];
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    SuggestionIndex* suggestions = suggestionIndexNew(map);
+    editDistanceInit(&engine);
+    for (int q = 0; q < 4; q++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            numScanned[q][c] = suggestionIndexFind(suggestions, &engine,
+                                                   misspellings[q],
+                                                   scanned[q][c], counts[c]);
+        }
+    }
+    suggestionIndexUseMethod(suggestions, SUGGEST_DELETES, 1);
+    for (int q = 0; q < 4; q++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int numFound = suggestionIndexFind(suggestions, &engine,
+                                               misspellings[q], found,
+                                               counts[c]);
+            CuAssertIntEquals(test, numScanned[q][c], numFound);
+            for (int i = 0; i < numFound; i++)
+            {
+                CuAssertIntEquals(test, scanned[q][c][i].index,
+                                  found[i].index);
+                CuAssertIntEquals(test, scanned[q][c][i].distance,
+                                  found[i].distance);
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(suggestions);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that a BK-tree holds every word once with the right edges, that it
+ * reports exactly the words within a fixed cutoff without measuring them
+ * all, and that suggestions found with one match the scan's.
+ * @param test
+ */
+void testBkTree(CuTest* test)
+{
+    printf("\n--- Testing BK-tree ---\n");
+    HashMap* map;
+    BatchCheck* check = batchCheckNew(test, &map);
+    
+    BkTree tree;
+    EditDistance engine;
+    EditDistancePattern pattern;
+    editDistanceInit(&engine);
+    bkTreeInit(&tree, &engine, check->words, check->lengths, check->size);
+    memset(check->reported, 0, sizeof(int) * check->size);
+    int badEdges = 0;
+    for (int n = 0; n < check->size; n++)
+    {
+        const BkNode* node = &tree.nodes[n];
+        check->reported[node->word]++;
+        for (int c = node->firstChild;
+             c < node->firstChild + node->numChildren; c++)
+        {
+            const BkNode* child = &tree.nodes[c];
+            badEdges += child->edge != levenshtein(check->words[node->word],
+                                                   check->words[child->word]);
+            badEdges += c > node->firstChild
+                        && tree.nodes[c - 1].edge >= child->edge;
+        }
+    }
+    CuAssertIntEquals(test, 0, badEdges);
+    for (int i = 0; i < check->size; i++)
+    {
+        CuAssertIntEquals(test, 1, check->reported[i]);
+    }
+    
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        int length = strlen(checkQueries[q]);
+        editDistancePatternInit(&pattern, checkQueries[q], length);
+        for (check->cutoff = 0; check->cutoff <= 2; check->cutoff++)
+        {
+            int mismatches = 0;
+            memset(check->reported, -1, sizeof(int) * check->size);
+            int evaluations = bkTreeFind(&tree, &engine, &pattern,
+                                         check->cutoff, batchCheckVisit,
+                                         check);
+            CuAssertTrue(test, evaluations < check->size);
+            for (int i = 0; i < check->size; i++)
+            {
+                int distance = editDistanceBounded(&engine, checkQueries[q],
+                                                   length, check->words[i],
+                                                   check->lengths[i],
+                                                   check->cutoff);
+                int expected = distance <= check->cutoff ? distance : -1;
+                mismatches += expected != check->reported[i];
+            }
+            CuAssertIntEquals(test, 0, mismatches);
+        }
+    }
+    bkTreeCleanUp(&tree);
+    batchCheckDelete(check);
+    
+    int counts[] = { 1, 5, SUGGEST_MAX_SUGGESTIONS };
+    Suggestion scanned[NUM_CHECK_QUERIES][3][SUGGEST_MAX_SUGGESTIONS];
+    int numScanned[NUM_CHECK_QUERIES][3];
+    Suggestion found[SUGGEST_MAX_SUGGESTIONS];
+    SuggestionIndex* index = suggestionIndexNew(map);
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            numScanned[q][c] = suggestionIndexFind(index, &engine,
+                                                   checkQueries[q],
+                                                   scanned[q][c], counts[c]);
+        }
+    }
+    suggestionIndexUseMethod(index, SUGGEST_BK_TREE, 0);
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int numFound = suggestionIndexFind(index, &engine, checkQueries[q],
+                                               found, counts[c]);
+            CuAssertIntEquals(test, numScanned[q][c], numFound);
+            for (int i = 0; i < numFound; i++)
+            {
+                CuAssertIntEquals(test, scanned[q][c][i].index,
+                                  found[i].index);
+                CuAssertIntEquals(test, scanned[q][c][i].distance,
+                                  found[i].distance);
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that a DAWG finds exactly the words it was built from, merges
+ * shared suffixes, reports exactly the words within a cutoff, and that
+ * suggestions found with one match the scan's.
+ * @param test
+ */
+void testDawg(CuTest* test)
+{
+    printf("\n--- Testing DAWG ---\n");
+    const char* words[] = {
+        "tabs", "", "ab", "abc", "b", "ab", "cabs", "tab", "cab", "a"
+    };
+    const char* missing[] = { "ac", "abcd", "ta", "cabss", "c", "bb" };
+    int lengths[10];
+    Dawg dawg;
+    for (int i = 0; i < 10; i++)
+    {
+        lengths[i] = strlen(words[i]);
+    }
+    dawgInit(&dawg, words, lengths, 10);
+    CuAssertIntEquals(test, 9, dawg.size);
+    for (int i = 0; i < 10; i++)
+    {
+        int found = dawgFind(&dawg, words[i], lengths[i]);
+        CuAssertTrue(test, found == i || (i == 5 && found == 2)
+                           || (i == 2 && found == 5));
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        CuAssertIntEquals(test, -1, dawgFind(&dawg, missing[i],
+                                             strlen(missing[i])));
+    }
+    // "tab" and "cab" end in the same node, as do "tabs" and "cabs"
+    CuAssertTrue(test, dawg.numNodes < 10);
+    dawgCleanUp(&dawg);
+    
+    HashMap* map;
+    BatchCheck* check = batchCheckNew(test, &map);
+    dawgInit(&dawg, check->words, check->lengths, check->size);
+    CuAssertIntEquals(test, check->size, dawg.size);
+    for (int i = 0; i < check->size; i++)
+    {
+        CuAssertIntEquals(test, i, dawgFind(&dawg, check->words[i],
+                                            check->lengths[i]));
+    }
+    CuAssertIntEquals(test, -1, dawgFind(&dawg, "speling", 7));
+    
+    EditDistance engine;
+    EditDistancePattern pattern;
+    editDistanceInit(&engine);
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        int length = strlen(checkQueries[q]);
+        editDistancePatternInit(&pattern, checkQueries[q], length);
+        for (check->cutoff = 0; check->cutoff <= 2; check->cutoff++)
+        {
+            int mismatches = 0;
+            memset(check->reported, -1, sizeof(int) * check->size);
+            dawgFindNear(&dawg, &pattern, check->cutoff, batchCheckVisit,
+                         check);
+            for (int i = 0; i < check->size; i++)
+            {
+                int distance = editDistanceBounded(&engine, checkQueries[q],
+                                                   length, check->words[i],
+                                                   check->lengths[i],
+                                                   check->cutoff);
+                int expected = distance <= check->cutoff ? distance : -1;
+                mismatches += expected != check->reported[i];
+            }
+            CuAssertIntEquals(test, 0, mismatches);
+        }
+    }
+    dawgCleanUp(&dawg);
+    batchCheckDelete(check);
+    
+    int counts[] = { 1, 5, SUGGEST_MAX_SUGGESTIONS };
+    Suggestion scanned[SUGGEST_MAX_SUGGESTIONS];
+    Suggestion found[SUGGEST_MAX_SUGGESTIONS];
+    SuggestionIndex* index = suggestionIndexNew(map);
+    SuggestionIndex* walked = suggestionIndexNew(map);
+    suggestionIndexUseMethod(walked, SUGGEST_DAWG, 0);
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            int numScanned = suggestionIndexFind(index, &engine,
+                                                 checkQueries[q], scanned,
+                                                 counts[c]);
+            int numFound = suggestionIndexFind(walked, &engine,
+                                               checkQueries[q], found,
+                                               counts[c]);
+            CuAssertIntEquals(test, numScanned, numFound);
+            for (int i = 0; i < numFound; i++)
+            {
+                CuAssertIntEquals(test, scanned[i].index, found[i].index);
+                CuAssertIntEquals(test, scanned[i].distance,
+                                  found[i].distance);
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(index);
+    suggestionIndexDelete(walked);
+    hashMapDelete(map);
+}
+/**
+ * Tests that a Levenshtein automaton run over the DAWG a suggestion index
+ * builds for SUGGEST_AUTOMATON reports exactly the words the scan does
+ * within its distance, following only a small part of the graph, and
+ * that SUGGEST_AUTOMATON suggests the same words as the scan.
+ * @param test
+ */
+void testLevenshteinAutomaton(CuTest* test)
+{
+    printf("\n--- Testing Levenshtein automaton ---\n");
+    HashMap* map;
+    BatchCheck* check = batchCheckNew(test, &map);
+    SuggestionIndex* index = suggestionIndexNew(map);
+    SuggestionIndex* run = suggestionIndexNew(map);
+    suggestionIndexUseMethod(run, SUGGEST_AUTOMATON, 1);
+    // the automata run over the index's own graph, which numbers the words
+    // in the index's order
+    const Dawg* dawg = &run->dawg;
+    CuAssertIntEquals(test, check->size, run->size);
+    
+    EditDistance engine;
+    LevenshteinAutomaton automaton;
+    editDistanceInit(&engine);
+    for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+    {
+        int length = strlen(checkQueries[q]);
+        for (int k = 0; k <= LEVENSHTEIN_AUTOMATON_MAX_DISTANCE; k++)
+        {
+            levenshteinAutomatonInit(&automaton, checkQueries[q], length, k);
+            // a cutoff over the automaton's distance is capped to it
+            for (check->cutoff = 0; check->cutoff <= k + 1; check->cutoff++)
+            {
+                int limit = check->cutoff < k ? check->cutoff : k;
+                int mismatches = 0;
+                memset(check->reported, -1, sizeof(int) * check->size);
+                int edges = levenshteinAutomatonFind(&automaton, dawg,
+                                                     check->cutoff,
+                                                     batchCheckVisit, check);
+                CuAssertTrue(test, edges < dawg->numEdges / 10);
+                for (int i = 0; i < run->size; i++)
+                {
+                    int distance = editDistanceBounded(&engine,
+                                                       checkQueries[q],
+                                                       length, run->words[i],
+                                                       run->lengths[i],
+                                                       limit);
+                    int expected = distance <= limit ? distance : -1;
+                    mismatches += expected != check->reported[i];
+                }
+                CuAssertIntEquals(test, 0, mismatches);
+            }
+            levenshteinAutomatonCleanUp(&automaton);
+        }
+    }
+    batchCheckDelete(check);
+    
+    int counts[] = { 1, 5, SUGGEST_MAX_SUGGESTIONS };
+    Suggestion scanned[SUGGEST_MAX_SUGGESTIONS];
+    Suggestion found[SUGGEST_MAX_SUGGESTIONS];
+    for (int k = 1; k <= LEVENSHTEIN_AUTOMATON_MAX_DISTANCE; k++)
+    {
+        suggestionIndexUseMethod(run, SUGGEST_AUTOMATON, k);
+        for (int q = 0; q < NUM_CHECK_QUERIES; q++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                int numScanned = suggestionIndexFind(index, &engine,
+                                                     checkQueries[q],
+                                                     scanned, counts[c]);
+                int numFound = suggestionIndexFind(run, &engine,
+                                                   checkQueries[q], found,
+                                                   counts[c]);
+                CuAssertIntEquals(test, numScanned, numFound);
+                for (int i = 0; i < numFound; i++)
+                {
+                    CuAssertIntEquals(test, scanned[i].index,
+                                      found[i].index);
+                    CuAssertIntEquals(test, scanned[i].distance,
+                                      found[i].distance);
+                }
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(index);
+    suggestionIndexDelete(run);
+    hashMapDelete(map);
+}
+
+
+/**
+ * Tests that suggestions come out the same, in the same order, however
+ * many threads search for them, and that the words are ordered by
+ * distance and then alphabetically, every word being as frequent.
+ * @param test
+ */
+void testSuggestionThreads(CuTest* test)
+{
+    printf("\n--- Testing suggestion threads ---\n");
+    const char* queries[] = { "teh", "speling", "xylophoen", "qqqqqqqqqqqq" };
+    int counts[] = { 1, 5, SUGGEST_MAX_SUGGESTIONS };
+    int threads[] = { 2, 3, 8 };
+    Suggestion serial[SUGGEST_MAX_SUGGESTIONS];
+    Suggestion parallel[SUGGEST_MAX_SUGGESTIONS];
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    SuggestionIndex* index = suggestionIndexNew(map);
+    EditDistance engine;
+    editDistanceInit(&engine);
+    
+    for (int t = 0; t < 3; t++)
+    {
+        for (int q = 0; q < 4; q++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                suggestionIndexSetThreads(index, 1);
+                int numSerial = suggestionIndexFind(index, &engine,
+                                                    queries[q], serial,
+                                                    counts[c]);
+                CuAssertIntEquals(test, counts[c], numSerial);
+                for (int i = 1; i < numSerial; i++)
+                {
+                    int before = serial[i - 1].distance < serial[i].distance
+                        || (serial[i - 1].distance == serial[i].distance
+                            && strcmp(index->words[serial[i - 1].index],
+                                      index->words[serial[i].index]) < 0);
+                    CuAssertTrue(test, before);
+                }
+                
+                suggestionIndexSetThreads(index, threads[t]);
+                int numParallel = suggestionIndexFind(index, &engine,
+                                                      queries[q], parallel,
+                                                      counts[c]);
+                CuAssertIntEquals(test, numSerial, numParallel);
+                for (int i = 0; i < numSerial; i++)
+                {
+                    CuAssertIntEquals(test, serial[i].index,
+                                      parallel[i].index);
+                    CuAssertIntEquals(test, serial[i].distance,
+                                      parallel[i].distance);
+                }
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+}
+
+/**
+ * Tests that words at the same distance go to the more frequent one, then
+ * alphabetically, that the closest words match measuring every word, and
+ * that every method and thread count breaks the ties the same way.
+ * @param test
+ */
+void testSuggestionOrder(CuTest* test)
+{
+    printf("\n--- Testing suggestion order ---\n");
+    const char* words[] = { "rat", "hat", "cat", "bat", "cart", "dog" };
+    int frequencies[] = { 0, 3, 1, 3, 9, 9 };
+    const char* expected[] = { "bat", "hat", "cat", "rat", "cart", "dog" };
+    int distances[] = { 1, 1, 1, 1, 2, 3 };
+    Suggestion found[SUGGEST_MAX_SUGGESTIONS];
+    HashMap* map = hashMapNew(1);
+    for (int i = 0; i < 6; i++)
+    {
+        hashMapPut(map, words[i], frequencies[i]);
+    }
+    SuggestionIndex* index = suggestionIndexNew(map);
+    EditDistance engine;
+    editDistanceInit(&engine);
+    
+    for (int k = 1; k <= 6; k++)
+    {
+        int numFound = suggestionIndexFind(index, &engine, "xat", found, k);
+        CuAssertIntEquals(test, k, numFound);
+        for (int i = 0; i < numFound; i++)
+        {
+            CuAssertStrEquals(test, expected[i],
+                              index->words[found[i].index]);
+            CuAssertIntEquals(test, distances[i], found[i].distance);
+        }
+    }
+    CuAssertIntEquals(test, 6, suggestionIndexFind(index, &engine, "xat",
+                                                   found, 10));
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+    
+    // the furthest of the closest words is as close as any word left out
+    map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    index = suggestionIndexNew(map);
+    int numFound = suggestionIndexFind(index, &engine, "speling", found,
+                                       SUGGEST_MAX_SUGGESTIONS);
+    CuAssertIntEquals(test, SUGGEST_MAX_SUGGESTIONS, numFound);
+    int last = found[numFound - 1].distance;
+    int closer = 0;
+    for (int i = 0; i < index->size; i++)
+    {
+        int distance = levenshtein("speling", index->words[i]);
+        closer += distance < last;
+        for (int j = 0; j < numFound; j++)
+        {
+            if (found[j].index == i)
+            {
+                CuAssertIntEquals(test, distance, found[j].distance);
+            }
+        }
+    }
+    CuAssertTrue(test, closer < numFound);
+    
+    // a few counts shared by many words, so ties cross every partition
+    HashMap* counted = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    for (int i = 0; i < index->size; i++)
+    {
+        hashMapPut(counted, index->words[i], strlen(index->words[i]) % 3);
+    }
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+    map = counted;
+    index = suggestionIndexNew(map);
+    for (int i = 1; i < index->size; i++)
+    {
+        int before = index->frequencies[i - 1] > index->frequencies[i]
+            || (index->frequencies[i - 1] == index->frequencies[i]
+                && strcmp(index->words[i - 1], index->words[i]) < 0);
+        CuAssertTrue(test, before);
+    }
+    const char* queries[] = { "teh", "speling", "xylophoen" };
+    SuggestMethod methods[] = { SUGGEST_SCAN, SUGGEST_DELETES, SUGGEST_BK_TREE,
+                                SUGGEST_DAWG, SUGGEST_AUTOMATON };
+    Suggestion ranked[3][8][SUGGEST_MAX_SUGGESTIONS];
+    int numRanked[3][8];
+    suggestionIndexUseMethod(index, SUGGEST_SCAN, 2);
+    for (int q = 0; q < 3; q++)
+    {
+        for (int c = 0; c < 8; c++)
+        {
+            Suggestion* expected = ranked[q][c];
+            numRanked[q][c] = suggestionIndexFind(index, &engine, queries[q],
+                                                  expected, 1 + 7 * c);
+            for (int i = 1; i < numRanked[q][c]; i++)
+            {
+                int before = expected[i - 1].distance < expected[i].distance
+                    || (expected[i - 1].distance == expected[i].distance
+                        && expected[i - 1].index < expected[i].index);
+                CuAssertTrue(test, before);
+            }
+        }
+    }
+    
+    // each index is built once, the scan's on more than one thread
+    suggestionIndexSetThreads(index, 3);
+    for (int m = 0; m < 5; m++)
+    {
+        suggestionIndexUseMethod(index, methods[m], 2);
+        for (int q = 0; q < 3; q++)
+        {
+            for (int c = 0; c < 8; c++)
+            {
+                numFound = suggestionIndexFind(index, &engine, queries[q],
+                                               found, 1 + 7 * c);
+                CuAssertIntEquals(test, numRanked[q][c], numFound);
+                for (int i = 0; i < numFound; i++)
+                {
+                    CuAssertIntEquals(test, ranked[q][c][i].index,
+                                      found[i].index);
+                    CuAssertIntEquals(test, ranked[q][c][i].distance,
+                                      found[i].distance);
+                }
+            }
+        }
+    }
+    editDistanceCleanUp(&engine);
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+}
+
+/*
+ * One thread's share of testConcurrentSuggestions.
+ */
+typedef struct SuggestionThread
+{
+    SuggestionIndex* index;
+    const char* query;
+    Suggestion found[10];
+    int numFound;
+} SuggestionThread;
+
+/**
+ * Asks the thread's query a number of times with its own scratch memory,
+ * keeping the last answer.
+ * @param argument Pointer to the SuggestionThread.
+ * @return NULL
+ */
+void* suggestionThreadMain(void* argument)
+{
+    SuggestionThread* thread = argument;
+    EditDistance engine;
+    editDistanceInit(&engine);
+    for (int i = 0; i < 20; i++)
+    {
+        thread->numFound = suggestionIndexFind(thread->index, &engine,
+                                               thread->query, thread->found,
+                                               10);
+    }
+    editDistanceCleanUp(&engine);
+    return NULL;
+}
+
+/**
+ * Adds the value to the int the context points at.
+ * @param key
+ * @param value
+ * @param context
+ */
+void sumVisit(const char* key, int* value, void* context)
+{
+    *(int*)context += *value;
+}
+
+/**
+ * Tests that several threads can ask queries of one index at the same
+ * time and get the same answers as when asking alone, and that asking
+ * leaves the dictionary's values alone.
+ * @param test
+ */
+void testConcurrentSuggestions(CuTest* test)
+{
+    printf("\n--- Testing concurrent suggestions ---\n");
+    const char* queries[] = { "teh", "speling", "xylophoen", "recieve" };
+    SuggestionThread threads[8];
+    pthread_t ids[8];
+    Suggestion expected[4][10];
+    HashMap* map = hashMapNewBackend(1, HASH_MAP_OPEN_ADDRESSING);
+    CuAssertTrue(test, loadWordFile(map, "dictionary.txt") > 0);
+    SuggestionIndex* index = suggestionIndexNew(map);
+    EditDistance engine;
+    editDistanceInit(&engine);
+    for (int q = 0; q < 4; q++)
+    {
+        CuAssertIntEquals(test, 10, suggestionIndexFind(index, &engine,
+                                                        queries[q],
+                                                        expected[q], 10));
+    }
+    editDistanceCleanUp(&engine);
+    
+    suggestionIndexSetThreads(index, 3);
+    for (int t = 0; t < 8; t++)
+    {
+        threads[t].index = index;
+        threads[t].query = queries[t % 4];
+        pthread_create(&ids[t], NULL, suggestionThreadMain, &threads[t]);
+    }
+    for (int t = 0; t < 8; t++)
+    {
+        pthread_join(ids[t], NULL);
+        CuAssertIntEquals(test, 10, threads[t].numFound);
+        for (int i = 0; i < 10; i++)
+        {
+            CuAssertIntEquals(test, expected[t % 4][i].index,
+                              threads[t].found[i].index);
+            CuAssertIntEquals(test, expected[t % 4][i].distance,
+                              threads[t].found[i].distance);
+        }
+    }
+    
+    // loadWordFile stored 0 for every word, and nothing wrote over it.
+    int total = 0;
+    hashMapForEach(map, sumVisit, &total);
+    CuAssertIntEquals(test, 0, total);
+    suggestionIndexDelete(index);
+    hashMapDelete(map);
+}
+
 // --- Test Suite ---
 
 void addAllTests(CuSuite* suite)
@@ -348,7 +2532,33 @@ void addAllTests(CuSuite* suite)
     SUITE_ADD_TEST(suite, testSingleOver);
     SUITE_ADD_TEST(suite, testMultipleUnder);
     SUITE_ADD_TEST(suite, testMultipleOver);
+    SUITE_ADD_TEST(suite, testOpenAddressing);
     SUITE_ADD_TEST(suite, testValueUpdate);
+    SUITE_ADD_TEST(suite, testFindOrInsert);
+    SUITE_ADD_TEST(suite, testResizeRelinks);
+    SUITE_ADD_TEST(suite, testReserve);
+    SUITE_ADD_TEST(suite, testBorrowedKeys);
+    SUITE_ADD_TEST(suite, testArena);
+    SUITE_ADD_TEST(suite, testSaveLoad);
+    SUITE_ADD_TEST(suite, testIteration);
+    SUITE_ADD_TEST(suite, testDenseEntries);
+    SUITE_ADD_TEST(suite, testHashDistribution);
+    SUITE_ADD_TEST(suite, testSetHashFunction);
+    SUITE_ADD_TEST(suite, testOpenAddressingDictionary);
+    SUITE_ADD_TEST(suite, testCheckFile);
+    SUITE_ADD_TEST(suite, testLoadDictionary);
+    SUITE_ADD_TEST(suite, testEditDistance);
+    SUITE_ADD_TEST(suite, testBoundedEditDistance);
+    SUITE_ADD_TEST(suite, testPatternEditDistance);
+    SUITE_ADD_TEST(suite, testBatchEditDistance);
+    SUITE_ADD_TEST(suite, testBatchScanNearest);
+    SUITE_ADD_TEST(suite, testDeleteIndex);
+    SUITE_ADD_TEST(suite, testBkTree);
+    SUITE_ADD_TEST(suite, testDawg);
+    SUITE_ADD_TEST(suite, testLevenshteinAutomaton);
+    SUITE_ADD_TEST(suite, testSuggestionThreads);
+    SUITE_ADD_TEST(suite, testSuggestionOrder);
+    SUITE_ADD_TEST(suite, testConcurrentSuggestions);
 }
 
 int main()